@@ -1,44 +1,26 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 #include "framework.h"
-#define key "ESPipes"
+#include "game.h"
+#include "highscore.h"
+#include "level.h"
+#include "render.h"
+#include "server.h"
+#include "solver.h"
+#include "stats.h"
 
-// ----------------------------------------------------------------------------
-// Rotates the pipe depending on the rotation direction
-//
-// @param value                   value of the pipe before rotation
-// @param rotation                what direction is the pipe turning
-//
-// @return                        returns the data of the pipe after rotation
-//
-uint8_t rotate_pipe_without_conflict(uint8_t value, uint8_t rotation);
+#define BATCH_OPTION  "--batch"
+#define SERVER_OPTION "--server"
 
-// ----------------------------------------------------------------------------
-// Rotates the pipe depending on the rotation direction
-//
-// @param value                   value of the pipe before rotation
-// @param rotation                what direction is the pipe turning
-//
-// @return                        returns the data of the pipe after rotation
-//
-uint8_t rotate_pipe_with_conflict(uint8_t value, uint8_t rotation);
+// time spent in the phases of a turn, see STATS_ENV
+static Stats stats;
 
-// ----------------------------------------------------------------------------
-// Determens if there would be lost data if bitshifting is used
-//
-// @param value     value of the pipe before rotation
-// @param rotation   what direction is the pipe turning
-//
-bool could_conflict_occur(uint8_t value, uint8_t rotation);
-
-// ----------------------------------------------------------------------------
-// Removes all connections on the pipe
-//
-// @param value                   value of pipe
-//
-// @return                        returns the pipe without connections
-//
-uint8_t remove_pipe_connections(uint8_t value);
+// the commands and the name, read from stdin
+static LineReader input;
 
 // ----------------------------------------------------------------------------
 // Determens if the input is correct
@@ -55,122 +37,110 @@ uint8_t remove_pipe_connections(uint8_t value);
 //
 // @return                        returns value dependant on the user input
 //
-bool is_input_valid(char* user_input, uint8_t cmmd,uint8_t direction,uint8_t row,uint8_t col,uint8_t height,uint8_t width, uint8_t* location_startPipe, uint8_t* location_endPipe);
+bool is_input_valid(char* user_input, uint8_t cmmd,uint8_t direction,uint32_t row,uint32_t col,uint32_t height,uint32_t width, uint32_t* location_startPipe, uint32_t* location_endPipe);
 
 // ----------------------------------------------------------------------------
-// Reads the input file and parse-s the data into usable forms
+// Parses and checks a command line, prints the error if it is not valid
 //
-// @param file                    file that will be read
-// @param magword                 magical word, or Key to determen if the file is valid
-// @param width                   the width of the map
-// @param height                  the height of the map
-// @param startPipe               location of the start pipe
-// @param endPipe                 location of the end pipe
-// @param submissions             amount of submissions contained in the file
-// @param size                    the amount of characters in the file
-//
-void get_map_properties(const char** file, char* magword, uint8_t* width, uint8_t* height, uint8_t* startPipe, uint8_t* endPipe,uint8_t* submissions, uint8_t* size);
-
-// ----------------------------------------------------------------------------
-// Copies the map data from the file to the map_data 
+// @param line                    the line entered by the user
+// @param game                    the running game
+// @param cmmd                    command that was given by the user
+// @param direction               what direction was entered
+// @param row                     inputed row of the map field
+// @param col                     inputed collumn of the map field
 //
-// @param file                    file that will be read
-// @param map_data                variable that contains the map data
-// @param submissions             amount of submissions contained in the file
-// @param size                    the amount of characters in the file
+// @return                        true if the command can be executed
 //
-void get_map_data(const char** file, uint8_t* map_data,uint8_t submissions, uint8_t size);
+bool read_command(char* line, const Game* game, Command* cmmd, size_t* direction, uint32_t* row, uint32_t* col);
 
 // ----------------------------------------------------------------------------
-// Converts the map into usuable 2d array for editing 
+// Executes a command that changes the map and ends the turn
 //
-// @param map_data                variable that contains the map data
-// @param map_array               variable that contains the map data
-// @param height                  the width of the map
-// @param width                   the hight of the map
+// @param game                    the running game
+// @param cmmd                    the checked command
+// @param direction               what direction was entered
+// @param row                     inputed row of the map field
+// @param col                     inputed collumn of the map field
+//
+// @return                        false if out of memory
 //
-void convert_map_to_2d_array(uint8_t* map_data, uint8_t **map_array, uint8_t height , uint8_t width);
+bool apply_command(Game* game, Command cmmd, size_t direction, uint32_t row, uint32_t col);
 
 // ----------------------------------------------------------------------------
-// Checks if there is a possible connections inbetween two pipes
+// Checks if the puzzle is solved and counts the time for the stats
+//
+// @param game                    the running game
 //
-// @param open_connections        is the connection even possible
-// @param value                   data of the pipe that is being analised
+// @return                        true if start- and dest-pipe are connected
 //
-void check_possible_connection(uint8_t* open_connections, uint8_t value);
+bool is_solved(const Game* game);
 
 // ----------------------------------------------------------------------------
-// Connects the pipes that are given
+// Prints rotations that connect the pipes, or that there are none
 //
-// @param map_data                variable that contains the map data
-// @param courrent_field          location of the currently selected pipe
-// @param above_field             pipe above the currently selected one
-// @param behind_field            pipe behind the currently selected one
-// @param bellow_field            pipe below the currently selected one
-// @param next_field              pipe after the currently selected one
+// @param game                    the running game
 //
-void connect_pipes(uint8_t *map_data,uint8_t* courrent_field, uint8_t* above_field, uint8_t* behind_field, uint8_t* bellow_field, uint8_t* next_field);
+// @return                        false if out of memory
+//
+bool print_solution(const Game* game);
 
 // ----------------------------------------------------------------------------
-// Goes trough the whole map and rebuilds the connections inbetween pipes
+// Starts another level of the pack, prints why if that is not possible
+//
+// @param pack                    the level pack
+// @param number                  number of the level, starting at 1
+// @param index                   index of the running level, set to the one
+//                                of the new level
+// @param level                   the running level, replaced by the new one
+// @param game                    the running game, replaced by the new one
+// @param switched                set to true if the level was started
 //
-// @param map_data                variable that contains the map data
-// @param height                  the width of the map
-// @param width                   the height of the map
+// @return                        false if out of memory
 //
-void rebuild_every_connection(uint8_t* map_data, uint8_t height, uint8_t width);
+bool switch_level(const LevelPack* pack, uint32_t number, uint32_t* index, Level* level, Game* game, bool* switched);
 
 // ----------------------------------------------------------------------------
-// Updates the map data to the courrent one
+// Prints the stats to stderr, registered with atexit if they are enabled
 //
-// @param map_data                variable that contains the map data
-// @param height                  the width of the map
-// @param width                   the height of the map
-// @param row                     inputed row of the map field
-// @param col                     inputed collumn of the map field
-// @param new_value               the value of the new pipe
-//
-void edit_map_field(uint8_t *map_data, uint8_t height , uint8_t width, uint8_t row, uint8_t col, uint8_t new_value);
+void dump_stats(void);
 
 // ----------------------------------------------------------------------------
-// Gets the data of the desired pipe
-//
-// @param map_data                variable that contains the map data
-// @param height                  the width of the map
-// @param width                   the height of the map
-// @param row                     inputed row of the map field
-// @param col                     inputed collumn of the map field
+// Applies every command from stdin without printing the map in between
 //
-// @return                        returns the data of the desired pipe
+// Stops at the end of the input, on quit or once the puzzle is solved and
+// prints the final map and the result. Entering a highscore is skipped.
 //
-uint8_t get_map_value(uint8_t *map_data, uint8_t height , uint8_t width, uint8_t row, uint8_t col );
-
-// ----------------------------------------------------------------------------
-// Updates the submissions_result variable with the new highscore
+// @param pack                    the level pack, for the level command
+// @param level                   the running level
+// @param game                    the running game
 //
-// @param submissions_result      submissions currently int the config file
-// @param username_score          score of the user
-// @param amount_of_submissions   the maximum supported ammount of submissions
+// @return                        exit code of the program
 //
-void update_highscore(char *submissions_result, char* username_score, uint8_t amount_of_submissions);
+int run_batch(const LevelPack* pack, Level* level, Game* game);
 
 // ----------------------------------------------------------------------------
-// Updates the config file with the new highscore
+// Asks for a 3-letter name until a valid one is entered
+//
+// @param username                set to the name in uppercase
 //
-// @param file                    file that will be read
-// @param submissions             location where the submissions are stored
-// @param score                   the new submission data
+// @return                        false if the input ended before
 //
-void update_existing_file(const char** file, uint8_t submissions, char* score);
+bool read_name(char* username);
 
 // ----------------------------------------------------------------------------
-// Gets the scores and the names of previous submissions
+// Prints the score of a solved game, asks for a name if it beats a
+// highscore and prints the highscore table
 //
-// @param file                    file that will be read
-// @param submissions             location where the submissions are stored
-// @param score                   location where the data will be stored
+// @param config                  path of the config file or level pack, the
+//                                highscores are kept next to it
+// @param number                  number of the level in the pack, 0 for a
+//                                config file
+// @param level                   the loaded config file
+// @param score                   the score
 //
-void get_highscore_and_name(const char** file, uint8_t submissions, char* score);
+// @return                        false if out of memory
+//
+bool finish_game(const char* config, uint32_t number, const Level* level, uint32_t score);
 
 // ----------------------------------------------------------------------------
 // Makes sure that the text is uppercase
@@ -183,81 +153,7 @@ void toUpper(char *text);
 
 
 // ----------------------------------------------------------------------------
-uint8_t rotate_pipe_without_conflict(uint8_t value, uint8_t rotation)
-{
-  if (rotation == 3)
-  {
-    value = value>>2;
-    return value;
-  }
-  if (rotation == 1)
-  {
-    value = value<<2;
-    return value;
-  }
-  return value;
-}
-
-// ----------------------------------------------------------------------------
-uint8_t rotate_pipe_with_conflict(uint8_t value, uint8_t rotation)
-{
-  if (rotation == 3)
-  {
-    value = value>>2;
-    value += 128;
-    return value;
-  }
-  if (rotation == 1)
-  {
-    value = value<<2;
-    value += 2;
-    return value;
-  }
-  return value;
-}
-
-// ----------------------------------------------------------------------------
-bool could_conflict_occur(uint8_t value, uint8_t rotation)
-{
-  if (((value & 128 ) == 128) && rotation == 1)
-  {
-    //printf("\nConflict 0\n\n");
-    return true;
-  }
-  if (((value & 2 ) == 2) && rotation == 3)
-  {
-    //printf("\nConflict 1\n\n");
-    return true;
-  }
-  return false;
-  
-}
-
-// ----------------------------------------------------------------------------
-uint8_t remove_pipe_connections(uint8_t value)
-{
-  uint8_t value_without_connections = value;
-  if ((value & 1 ) == 1)
-  {
-    value_without_connections -= 1;
-  }
-  if ((value & 4 ) == 4)
-  {
-    value_without_connections -= 4;
-  }
-  if ((value & 16 ) == 16)
-  {
-    value_without_connections -= 16;
-  }
-  if ((value & 64 ) == 64)
-  {
-    value_without_connections -= 64;
-  }
-  return value_without_connections;
-}
-
-// ----------------------------------------------------------------------------
-bool is_input_valid(char* user_input, uint8_t cmmd,uint8_t direction,uint8_t row,uint8_t col,uint8_t height,uint8_t width, uint8_t* location_startPipe, uint8_t* location_endPipe)
+bool is_input_valid(char* user_input, uint8_t cmmd,uint8_t direction,uint32_t row,uint32_t col,uint32_t height,uint32_t width, uint32_t* location_startPipe, uint32_t* location_endPipe)
 {
   if (cmmd == 1)
   {
@@ -297,7 +193,7 @@ bool is_input_valid(char* user_input, uint8_t cmmd,uint8_t direction,uint8_t row
   {
     return 1;
   }
-  else if(cmmd < 1 || cmmd > 4)
+  else if(cmmd < 1 || cmmd > LEVEL)
   {
     printf("Error: Unknown command: %s\n", user_input);
      
@@ -310,436 +206,469 @@ bool is_input_valid(char* user_input, uint8_t cmmd,uint8_t direction,uint8_t row
 }
 
 // ----------------------------------------------------------------------------
-void get_map_properties(const char** file, char* magword, uint8_t* width, uint8_t* height, uint8_t* startPipe, uint8_t* endPipe,uint8_t* submissions, uint8_t* size)
+bool read_name(char* username)
 {
-  char buffer[1];
-  FILE *ptr;
-  ptr = fopen(file[1],"r");
-  fseek(ptr, 0, SEEK_SET);
-  int i = 0;
-  while(!feof(ptr))
+  bool is_valid = false;
+  do
   {
-      fread(buffer, sizeof(char), 1, ptr);
-      //printf("%02x  ", buffer[0]);
-      if (i <= 6)
-      {
-      *magword = buffer[0];
-      magword++;
-      }
-      else if (i == 7)
-      {
-      *width = buffer[0];
-      }
-      else if (i == 8)
-      {
-      *height = buffer[0];
-      }
-      else if (i == 9 || i == 10)
-      {
-      *startPipe = buffer[0];
-      startPipe++;
-      }
-      else if (i == 11 || i == 12)
-      {
-      *endPipe = buffer[0];
-      endPipe++;
-      }
-      else if (i == 13 )
+    printf("%s",INPUT_NAME);
+    if (!readWord(&input, username, 64))
+    {
+      return false;
+    }
+    if(username[1] == '\0' || username[2] == '\0' || username[3] != '\0')
+    {
+      printf("%s",ERROR_NAME_LENGTH);
+      is_valid = false;
+    }
+    else
+    {
+      is_valid = true;
+    }
+    for (int i = 0; i < 3 && is_valid; i++)
+    {
+      if (!((username[i] >= 97 && username[i] <= 122) || (username[i] >= 65 && username[i] <= 90)))
       {
-      *submissions = buffer[0];
+        printf("%s",ERROR_NAME_ALPHABETIC);
+        is_valid = false;
       }
-      
-      i++;
-  }
-  *size = i;
-  fclose(ptr);
+    }
+  } while (is_valid == false);
+  toUpper(username);
+  return true;
 }
 
 // ----------------------------------------------------------------------------
-void get_map_data(const char** file, uint8_t* map_data,uint8_t submissions, uint8_t size)
+bool finish_game(const char* config, uint32_t number, const Level* level, uint32_t score)
 {
-  char buffer[1];
-  FILE *ptr;
-  ptr = fopen(file[1],"r");
-  fseek(ptr, (14 + (submissions * 4)), SEEK_SET);
-  
-  for (int i = 0; i < (size - (14 + (submissions * 4))); i++)
+  Highscores highscores;
+  if (!highscores_open(&highscores, config, number, level))
   {
-    fread(buffer, sizeof(char), 1, ptr);
-    *map_data = buffer[0];
-    map_data++;
+    printf("%s", ERROR_OUT_OF_MEMORY);
+    return false;
+  }
+  printf("%s",INFO_PUZZLE_SOLVED);
+  printf(INFO_SCORE, score);
+  if (highscores_qualifies(&highscores, score))
+  {
+    char username[64];
+    printf("%s",INFO_BEAT_HIGHSCORE);
+    if (read_name(username))
+    {
+      highscores_add(&highscores, score, username);
+    }
   }
 
-  fclose(ptr);
+  HighscoreEntry entries[UINT8_MAX];
+  size_t count = highscores_top(&highscores, entries, level->submissions);
+  printf("%s",INFO_HIGHSCORE_HEADER);
+  for (size_t i = 0; i < count; i++)
+  {
+    char name[HIGHSCORE_NAME_SIZE + 1] = { 0 };
+    memcpy(name, entries[i].name, HIGHSCORE_NAME_SIZE);
+    printf(INFO_HIGHSCORE_ENTRY, name, entries[i].score);
+  }
+  highscores_close(&highscores);
+  return true;
 }
 
 // ----------------------------------------------------------------------------
-void convert_map_to_2d_array(uint8_t* map_data, uint8_t **map_array, uint8_t height , uint8_t width)
+void toUpper(char *text) 
 {
-  for (int i = 0; i < height; i++)
+  for (int i = 0; i <= 25; i++)
   {
-    for (int j = 0; j < width; j++)
+    if (*text != ' ' && *text >= 97 && *text <= 122)
     {
-      *((map_array+i)+j) = &map_data[0];
-      map_data++;
+      *text = *text - 32;
     }
+    if (*text == '\0')
+    {
+     break;
+    }
+    text++;
   }
 }
 
 // ----------------------------------------------------------------------------
-void check_possible_connection(uint8_t* open_connections, uint8_t value)
+bool read_command(char* line, const Game* game, Command* cmmd, size_t* direction, uint32_t* row, uint32_t* col)
 {
-  if ((value & 128 ) == 128)
+  char* error = parseCommand(line, cmmd, direction, row, col);
+  if (error == (char*) 1 && *cmmd == LEVEL)
   {
-    open_connections[0] = 1;//top open
-  }else
-  {
-    open_connections[0] = 0;//top open
+    printf("%s", USAGE_COMMAND_LEVEL);
+    return false;
   }
-  if ((value & 32 ) == 32)
-  {
-    open_connections[1] = 1;//left open 
-  }else
+  if (error == (char*) 1)
   {
-    open_connections[1] = 0;//left open 
+    *direction = 0;   // makes is_input_valid print the usage
   }
-  if ((value & 8 ) == 8)
+  else if (error != NULL)
   {
-    open_connections[2] = 1;//bottom open
-  }else
-  {
-    open_connections[2] = 0;//bottom open
+    *cmmd = NONE;     // unknown command
+    line = error;
   }
-  if ((value & 2 ) == 2)
+  if (*cmmd == UNDO && !game_can_undo(game))
   {
-    open_connections[3] = 1;//right open
-  }else
+    printf("%s", ERROR_NOTHING_TO_UNDO);
+    return false;
+  }
+  if (*cmmd == REDO && !game_can_redo(game))
   {
-    open_connections[3] = 0;//right open
+    printf("%s", ERROR_NOTHING_TO_REDO);
+    return false;
   }
+  return is_input_valid(line, *cmmd, *direction, *row, *col, game->grid.height, game->grid.width,
+    (uint32_t*) game->start, (uint32_t*) game->dest);
 }
 
 // ----------------------------------------------------------------------------
-void connect_pipes(uint8_t *map_data,uint8_t* courrent_field, uint8_t* above_field, uint8_t* behind_field, uint8_t* bellow_field, uint8_t* next_field)
+bool apply_command(Game* game, Command cmmd, size_t direction, uint32_t row, uint32_t col)
 {
-  map_data[0] = remove_pipe_connections(map_data[0]);
-  if(courrent_field[0] == 1 && above_field[2] == 1)
-  {
-    map_data[0] += 64; 
-  }
-  if(courrent_field[1] == 1 && behind_field[3] == 1)
+  uint64_t start = stats_start(&stats);
+  if (!game_apply(game, cmmd, direction, row, col))
   {
-    map_data[0] += 16; 
-  }
-  if(courrent_field[2] == 1 && bellow_field[0] == 1)
-  {
-    map_data[0] += 4; 
-  }
-  if(courrent_field[3] == 1 && next_field[1] == 1)
-  {
-    map_data[0] += 1; 
+    return false;
   }
+  stats_stop(&stats, STATS_ROTATE, start);
+
+  start = stats_start(&stats);
+  game_end_turn(game);
+  stats_stop(&stats, STATS_REBUILD, start);
+  return true;
 }
 
 // ----------------------------------------------------------------------------
-void rebuild_every_connection(uint8_t* map_data, uint8_t height, uint8_t width)
+bool is_solved(const Game* game)
 {
-  uint8_t courrent_field[4];
-  uint8_t above_field[4];
-  uint8_t behind_field[4];
-  uint8_t bellow_field[4];
-  uint8_t next_field[4];
-  for (int i = 1; i <= height; i++)
-  {
-    for (int j = 1; j <=  width; j++)
-    {
-      check_possible_connection(&courrent_field[0], map_data[0]);
-      check_possible_connection(&above_field[0], map_data[0-width]);
-      check_possible_connection(&behind_field[0], map_data[0-1]);
-      check_possible_connection(&next_field[0], map_data[1] );
-      check_possible_connection(&bellow_field[0], map_data[width]);
-      connect_pipes(&map_data[0], &courrent_field[0], &above_field[0], &behind_field[0], &bellow_field[0], &next_field[0]);
-      map_data++;
-    }
-  }
+  uint64_t start = stats_start(&stats);
+  bool solved = game_is_solved(game);
+  stats_stop(&stats, STATS_CONNECTED, start);
+  return solved;
 }
 
 // ----------------------------------------------------------------------------
-void edit_map_field(uint8_t *map_data, uint8_t height , uint8_t width, uint8_t row, uint8_t col, uint8_t new_value)
+bool print_solution(const Game* game)
 {
-  for (int i = 1; i <= height; i++)
-  {
-    for (int j = 1; j <= width; j++)
-    {
-      if (row  == i && col == j)
-      {
-        map_data[0] = new_value;
-      }
-      map_data++;
-    }
-  }
+  Solution solution;
+  // deterministic, so the same map always prints the same rotations
+  switch (solver_solve_parallel(game, 0, true, &solution))
+  {
+    case SOLVER_OK:
+    case SOLVER_LIMIT:    // only with a budget
+      break;
+    case SOLVER_UNSOLVABLE:
+      printf("%s", ERROR_NO_SOLUTION);
+      return true;
+    case SOLVER_MEMORY:
+      return false;
+  }
+  printf(INFO_SOLUTION, solution.count);
+  for (size_t i = 0; i < solution.count; i++)
+  {
+    Move* move = &solution.moves[i];
+    printf(INFO_SOLUTION_MOVE, (move->direction == 3) ? "right" : "left",
+      move->field / game->grid.width + 1, move->field % game->grid.width + 1);
+  }
+  solution_free(&solution);
+  return true;
 }
 
 // ----------------------------------------------------------------------------
-uint8_t get_map_value(uint8_t *map_data, uint8_t height , uint8_t width, uint8_t row, uint8_t col )
-{ 
-  uint8_t temp = 0; 
-  for (int i = 0; i < height; i++)
+bool switch_level(const LevelPack* pack, uint32_t number, uint32_t* index, Level* level, Game* game, bool* switched)
+{
+  Level next;
+  Game started;
+  *switched = false;
+  if (number > pack->count)
   {
-    for (int j = 0; j < width; j++)
-    {
-      if (row == i+1 && col == j+1)
-      {
-        temp = map_data[0];
-        return temp;
-      }
-      map_data++;
-    }
+    printf(ERROR_LEVEL_MISSING, number);
+    return true;
   }
-  return temp;
-}
-
-// ----------------------------------------------------------------------------
-void update_highscore(char *submissions_result, char* username_score, uint8_t amount_of_submissions)
-{
-  uint8_t username_entered = 0;
-  for (int i = 0; (amount_of_submissions * 4) > i; i = i+4)
+  switch (level_pack_get(pack, number - 1, &next))
   {
-    char temp[4];
-    temp[0] = submissions_result[i];
-    temp[1] = submissions_result[i+1];
-    temp[2] = submissions_result[i+2];
-    temp[3] = submissions_result[i+3];
-    if (temp[0] > username_score[0] && username_entered == 0)
-    {
-      submissions_result[i] = username_score[0];
-      submissions_result[i+1] = username_score[1];
-      submissions_result[i+2] = username_score[2];
-      submissions_result[i+3] = username_score[3];
-      username_entered = 1;
-    }
-    if (username_entered == 1)
-    {
-      username_score[0] = temp[0];
-      username_score[1] = temp[1];
-      username_score[2] = temp[2];
-      username_score[3] = temp[3];
-      username_entered = 0;
-    }
+    case LEVEL_OK:
+      break;
+    case LEVEL_ERROR_MEMORY:
+      return false;
+    default:
+      printf(ERROR_LEVEL_INVALID, number);
+      return true;
   }
-}
-
-// ----------------------------------------------------------------------------
-void update_existing_file(const char** file, uint8_t submissions, char* score)
-{
-  FILE *ptr;
-  ptr = fopen(file[1],"r+");
-  fseek(ptr, 14, SEEK_SET);
-  for (int i = 0; i < (submissions * 4); i++)
+  if (!game_init(&started, &next))
   {
-    fputc(score[0], ptr);
-    score++;
+    level_close(&next);
+    return false;
   }
-  fclose(ptr);
+  game_free(game);
+  level_close(level);
+  *game = started;
+  *level = next;
+  *index = number - 1;
+  *switched = true;
+  return true;
 }
 
 // ----------------------------------------------------------------------------
-void get_highscore_and_name(const char** file, uint8_t submissions, char* score)
+void dump_stats(void)
 {
-  char buffer[1] = {'\0'};
-  FILE *ptr;
-  ptr = fopen(file[1],"r");
-  fseek(ptr, 14, SEEK_SET);
-  for (int i = 0; i < (submissions * 4); i++)
-  {
-    fread(buffer, sizeof(char), 1, ptr);
-    *score = buffer[0];
-    score++;
-  }
-  fclose(ptr);
+  fflush(stdout);
+  stats_print(&stats, stderr);
 }
 
 // ----------------------------------------------------------------------------
-void toUpper(char *text) 
+int run_batch(const LevelPack* pack, Level* level, Game* game)
 {
-  for (int i = 0; i <= 25; i++)
+  uint32_t index = 0;
+  char* line;
+  size_t commands = 0;
+  Command cmmd;
+  size_t direction;
+  uint32_t row;
+  uint32_t col;
+  while (!is_solved(game))
   {
-    if (*text != ' ' && *text >= 97 && *text <= 122)
+    uint64_t start = stats_start(&stats);
+    if ((line = readLine(&input)) == NULL)
     {
-      *text = *text - 32;
+      break;
     }
-    if (*text == '\0')
+    commands++;
+    direction = 0;
+    row = 0;
+    col = 0;
+    bool valid = read_command(line, game, &cmmd, &direction, &row, &col);
+    stats_stop(&stats, STATS_INPUT, start);
+    if (!valid)
     {
-     break;
+      continue;
     }
-    text++;
+    if (cmmd == QUIT)
+    {
+      break;
+    }
+    if (cmmd == STATS)
+    {
+      stats_print(&stats, stdout);
+      continue;
+    }
+    if (cmmd == SOLVE)
+    {
+      if (!print_solution(game))
+      {
+        printf("%s", ERROR_OUT_OF_MEMORY);
+        return 4;
+      }
+      continue;
+    }
+    if (cmmd == LEVEL)
+    {
+      bool switched;
+      if (!switch_level(pack, row, &index, level, game, &switched))
+      {
+        printf("%s", ERROR_OUT_OF_MEMORY);
+        return 4;
+      }
+      continue;
+    }
+    if (!apply_command(game, cmmd, direction, row, col))
+    {
+      printf("%s", ERROR_OUT_OF_MEMORY);
+      return 4;
+    }
+  }
+
+  printMap(game->grid.rows, game->grid.width, game->grid.height, game->start, game->dest);
+  if (game_is_solved(game))
+  {
+    printf("%s", INFO_PUZZLE_SOLVED);
+    printf(INFO_SCORE, game->turn - 1);
+  }
+  else
+  {
+    printf("%s", INFO_PUZZLE_UNSOLVED);
   }
+  printf(INFO_COMMANDS, commands);
+  return 0;
 }
 
 int main(int argc, char const **argv)
 {
-  char magic_word[7];
-  uint8_t width = '\0';
-  uint8_t height = '\0';
-  uint8_t location_startPipe[2];
-  uint8_t location_endPipe[2];
-  uint8_t amount_of_submissions = '\0';
-  char *submissions_result;
-  uint8_t size;
-  uint8_t map_data[50];
-  uint8_t **map_array;
+  LevelPack pack;
+  Level level;
+  Game game;
+  Renderer renderer;
   char *user_input;
   Command cmmd;
   size_t direction;
-  uint8_t row;
-  uint8_t col;
-  uint8_t value_of_sector;
-  uint8_t value_after_rotation;
-  int g = 1;
-  if (argc != 2)
+  uint32_t row;
+  uint32_t col;
+  uint32_t index = 0;
+  initOutput(isatty(STDOUT_FILENO));
+  bool batch = argc == 3 && strcmp(argv[1], BATCH_OPTION) == 0;
+  bool server = argc == 4 && strcmp(argv[1], SERVER_OPTION) == 0;
+  const char* config = argv[argc - 1];
+  if (argc != 2 && !batch && !server)
   {
     printf("%s",USAGE_APPLICATION);
     return 1;
   }
+  stats_init(&stats);
+  initReader(&input, STDIN_FILENO);
+  if (stats.enabled)
+  {
+    atexit(dump_stats);
+  }
   
-  get_map_properties(&argv[0], &magic_word[0], &width, &height, &location_startPipe[0], &location_endPipe[0],&amount_of_submissions, &size);
-  
-  for (int i = 0; i < 7; i++)
+  // a config file is a pack of one level, a pack starts with its first level
+  LevelError error = level_pack_open(&pack, config);
+  if (error == LEVEL_OK)
   {
-    if (key[i] != magic_word[i])
+    error = level_pack_get(&pack, 0, &level);
+    if (error != LEVEL_OK)
     {
-      printf("Error: Invalid file: %s\n", argv[1]);
-      return 3;
+      level_pack_close(&pack);
     }
   }
-  
-  get_map_data(&argv[0], &map_data[0], amount_of_submissions, size);
-  map_array = (uint8_t**) malloc(sizeof(uint8_t*) * height);
-  for (int i = 0; i < height; i++)
+  switch (error)
   {
-    *(map_array + i) = (uint8_t*) malloc(sizeof(uint8_t)*width);
-
+    case LEVEL_OK:
+      break;
+    case LEVEL_ERROR_OPEN:
+      printf(ERROR_OPEN_FILE, config);
+      return 2;
+    case LEVEL_ERROR_INVALID:
+      printf(ERROR_INVALID_FILE, config);
+      return 3;
+    case LEVEL_ERROR_MEMORY:
+      printf("%s", ERROR_OUT_OF_MEMORY);
+      return 4;
   }
-  while (g >= 1)
+  if (!game_init(&game, &level))
+  {
+    printf("%s", ERROR_OUT_OF_MEMORY);
+    level_close(&level);
+    level_pack_close(&pack);
+    return 4;
+  }
+  if (server)
+  {
+    game_free(&game);
+    level_close(&level);
+    int result = run_server(argv[2], config, &pack);
+    level_pack_close(&pack);
+    return result;
+  }
+  if (batch)
+  {
+    int result = run_batch(&pack, &level, &game);
+    game_free(&game);
+    level_close(&level);
+    level_pack_close(&pack);
+    return result;
+  }
+
+  render_init(&renderer, game.grid.width, game.grid.height);
+  while (game.turn >= 1)
   {
-    convert_map_to_2d_array(&map_data[0], &map_array[0], height, width );
-    printMap(map_array, width, height, location_startPipe, location_endPipe);
-    bool is_finished = arePipesConnected(map_array, width, height, location_startPipe, location_endPipe);
-    if (is_finished == true)
+    uint64_t start = stats_start(&stats);
+    render_map(&renderer, game.grid.rows, game.start, game.dest);
+    stats_stop(&stats, STATS_RENDER, start);
+    if (is_solved(&game))
     {
-      printf("%s",INFO_PUZZLE_SOLVED);
-      printf("Score: %d\n",g - 1); 
-      submissions_result = (char* )malloc((amount_of_submissions * 4) * sizeof(char));
-      get_highscore_and_name(&argv[0], amount_of_submissions, &submissions_result[0]);
-      char username[4];
-      for (int i = 0; i < 5; i++)
-      {
-        user_input[i]= '\0';map_array = (uint8_t**) malloc(sizeof(uint8_t*) * height);
-        for (int i = 0; i < height; i++)
-        {
-          *(map_array) = (uint8_t*) malloc(sizeof(uint8_t)*width);
-        }
-        
-        for (int i = 0; i <= amount_of_submissions; i++)
-        {
-          if(submissions_result[(i*4)-4] > (g-1))
-          {
-            printf("%s",INFO_BEAT_HIGHSCORE);
-            bool is_valid = false;
-            do
-            {
-              printf("%s",INPUT_NAME);
-              scanf("%s",username);
-              if(username[1] == '\0' || username[2] == '\0' || username[3] != '\0')
-              {
-                printf("%s",ERROR_NAME_LENGTH);
-                is_valid = false;
-              }
-              else
-              {
-                is_valid = true;
-              }
-              for (int i = 0; i < 3; i++)           
-              {
-                if ((username[i] >= 97 && username[i] <= 122) || (username[i] >= 65 && username[i] <= 90))
-                {
-
-                }
-                else
-                {
-                  printf("%s",ERROR_NAME_ALPHABETIC);
-                  is_valid = false;
-                }
-                
-              }
-              
-              
-            } while (is_valid == false);
-            toUpper(username); 
-            char username_score[4]= {g -1 ,username[0],username[1],username[2]};
-            update_highscore(&submissions_result[0], &username_score[0], amount_of_submissions);
-            update_existing_file(&argv[0],amount_of_submissions, &submissions_result[0]);
-            break;
-          }      
-        }
-        printf("%s",INFO_HIGHSCORE_HEADER);
-        for (int i = 0; i < (amount_of_submissions * 4); i = i + 4)
-        {
-          printf("   %c", submissions_result[i+1]);
-          printf("%c", submissions_result[i+2]);
-          printf("%c ", submissions_result[i+3]);
-          printf("%d\n", submissions_result[i]);
-        }
-        free(submissions_result);
-        return 0;
-      }
+      bool finished = finish_game(config, pack.indexed ? index + 1 : 0, &level, (uint32_t) (game.turn - 1));
+      game_free(&game);
+      render_free(&renderer);
+      level_close(&level);
+      level_pack_close(&pack);
+      return finished ? 0 : 4;
     }
     int valid_input = 0;
+    bool switched = false;
     do
     {
       direction = 0;
       row = 0;
       col = 0;
-      printf("%d > ", g);
-      user_input = malloc(sizeof(char)* 50);
-      user_input = getLine();
-      parseCommand(&user_input[0], &cmmd, &direction, &row, &col);
-      valid_input = is_input_valid(&user_input[0], cmmd, direction, row, col, height, width, &location_startPipe[0], &location_endPipe[0]);
-      free(user_input);
-      if (cmmd == 2)
+      printf("%d > ", game.turn);
+      start = stats_start(&stats);
+      user_input = readLine(&input);
+      if (user_input == NULL)
+      {
+        // a last line without newline was executed like the others before
+        cmmd = QUIT;
+      }
+      else
+      {
+        valid_input = read_command(user_input, &game, &cmmd, &direction, &row, &col);
+      }
+      stats_stop(&stats, STATS_INPUT, start);
+      if (cmmd == STATS && valid_input)
+      {
+        // only looking at the stats does not cost a turn
+        stats_print(&stats, stdout);
+        valid_input = 0;
+      }
+      if (cmmd == SOLVE && valid_input)
+      {
+        // neither does asking for a solution
+        valid_input = 0;
+        if (!print_solution(&game))
+        {
+          printf("%s", ERROR_OUT_OF_MEMORY);
+          game_free(&game);
+          render_free(&renderer);
+          level_close(&level);
+          level_pack_close(&pack);
+          return 4;
+        }
+      }
+      if (cmmd == LEVEL && valid_input)
+      {
+        if (!switch_level(&pack, row, &index, &level, &game, &switched))
+        {
+          printf("%s", ERROR_OUT_OF_MEMORY);
+          game_free(&game);
+          render_free(&renderer);
+          level_close(&level);
+          level_pack_close(&pack);
+          return 4;
+        }
+        valid_input = switched;
+      }
+      if (cmmd == HELP)
       {
         printf("%s",HELP_TEXT);
       }
-      if (cmmd == 3)
+      if (cmmd == QUIT)
       {
-        free(map_array);
-
+        game_free(&game);
+        render_free(&renderer);
+        level_close(&level);
+        level_pack_close(&pack);
         exit(0);
       }
-      if (cmmd == 4)
+      if (valid_input == 0 || cmmd == HELP)
       {
-        get_map_data(&argv[0], &map_data[0], amount_of_submissions, size);
-        g = 0;
+        // an error, the help or a solution was printed below the map
+        render_dirty(&renderer);
       }
     } while ( valid_input == 0);
-    g++;
-    if (direction == 3)   //flipping the directions 
+    if (switched)
     {
-      direction = 1;
-    }else
-    {
-      direction = 3;
+      // the new level starts with its first turn
+      render_free(&renderer);
+      render_init(&renderer, game.grid.width, game.grid.height);
+      continue;
     }
-    value_of_sector = get_map_value(&map_data[0], height , width, row, col);
-    if (value_of_sector > 0 && value_of_sector < 255)
+    // row and col were checked by is_input_valid, they start at 1 there
+    if (!apply_command(&game, cmmd, direction, row, col))
     {
-      value_after_rotation = remove_pipe_connections(value_of_sector);    
-      (could_conflict_occur(value_after_rotation, direction)) ? (value_after_rotation = rotate_pipe_with_conflict(value_after_rotation, direction)) :
-        (value_after_rotation = rotate_pipe_without_conflict(value_after_rotation, direction));
-      edit_map_field(&map_data[0], height , width, row, col, value_after_rotation);
+      printf("%s", ERROR_OUT_OF_MEMORY);
+      game_free(&game);
+      render_free(&renderer);
+      level_close(&level);
+      level_pack_close(&pack);
+      return 4;
     }
-    rebuild_every_connection(&map_data[0],height, width);
   }
 }
-
-
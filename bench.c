@@ -0,0 +1,519 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "framework.h"
+#include "game.h"
+#include "level.h"
+#include "solver.h"
+
+#define USAGE_BENCH "Usage: ./bench CONFIG_FILE...\n"
+
+// one line per benchmark and map, separated by tabs
+#define BENCH_HEADER "benchmark\twidth\theight\tops\tns_per_op\tops_per_sec\twrites_per_op\n"
+#define BENCH_RESULT "%s\t%u\t%u\t%zu\t%.1f\t%.0f\t%s\n"
+
+// the write system calls of the process so far, counted by Linux
+#define BENCH_IO_FILE  "/proc/self/io"
+#define BENCH_IO_WRITES "syscw: %llu"
+
+// every benchmark is repeated until it ran at least this long
+#define BENCH_MIN_NS 200000000.0
+
+// number of commands of the replay benchmarks
+static const size_t REPLAY_COMMANDS[] = { 1000, 100000 };
+
+// ----------------------------------------------------------------------------
+// Everything a benchmark needs, <commands> are only used by the replay
+//
+typedef struct _Bench_
+{
+  const char* path;
+  uint32_t index;       // of the level in <path>, 0 for a config file
+  Game* game;
+  char** commands;
+  size_t count;
+  size_t threads;
+} Bench;
+
+static FILE* results;
+static uint64_t random_state = 1;
+
+// ----------------------------------------------------------------------------
+static uint32_t random_below(uint32_t bound)
+{
+  random_state ^= random_state << 13;
+  random_state ^= random_state >> 7;
+  random_state ^= random_state << 17;
+  return (uint32_t) ((random_state >> 32) * bound >> 32);
+}
+
+// ----------------------------------------------------------------------------
+static double now_ns(void)
+{
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return time.tv_sec * 1e9 + time.tv_nsec;
+}
+
+// ----------------------------------------------------------------------------
+// @return  the number of write system calls so far, -1 if it is unknown
+//
+static double count_writes(void)
+{
+  FILE* file = fopen(BENCH_IO_FILE, "r");
+  if (file == NULL)
+  {
+    return -1;
+  }
+  char line[64];
+  unsigned long long writes = 0;
+  bool found = false;
+  while (!found && fgets(line, sizeof(line), file) != NULL)
+  {
+    found = sscanf(line, BENCH_IO_WRITES, &writes) == 1;
+  }
+  fclose(file);
+  return found ? (double) writes : -1;
+}
+
+// ----------------------------------------------------------------------------
+// Picks a random field that is neither start- nor dest-pipe
+//
+// @return  false if the map has no such field
+//
+static bool random_field(const Game* game, uint32_t* row, uint32_t* col)
+{
+  if (grid_size(&game->grid) <= 2)
+  {
+    return false;
+  }
+  do
+  {
+    *row = random_below(game->grid.height);
+    *col = random_below(game->grid.width);
+  } while ((*row == game->start[0] && *col == game->start[1]) || (*row == game->dest[0] && *col == game->dest[1]));
+  return true;
+}
+
+// ----------------------------------------------------------------------------
+// Builds a solved map in which every field is connected to the start pipe:
+// a row of straight pipes from every field of the first column, which joins
+// the rows from top to bottom
+//
+// @return  false if out of memory or the map has less than two fields
+//
+static bool comb_init(Game* game, uint32_t width, uint32_t height)
+{
+  size_t size = (size_t) width * height;
+  if (size < 2)
+  {
+    return false;
+  }
+  uint8_t* fields = (uint8_t*) calloc(size, 1);
+  if (fields == NULL)
+  {
+    return false;
+  }
+  for (uint32_t row = 0; row < height; row++)
+  {
+    for (uint32_t col = 0; col < width; col++)
+    {
+      // the openings up, left, down and right, see README.md#datentypen
+      uint8_t value = (uint8_t) (((col > 0) ? 0x20 : 0) | ((col < width - 1) ? 0x02 : 0));
+      if (col == 0)
+      {
+        value |= (uint8_t) (((row > 0) ? 0x80 : 0) | ((row < height - 1) ? 0x08 : 0));
+      }
+      fields[(size_t) row * width + col] = value;
+    }
+  }
+  Level level;
+  memset(&level, 0, sizeof(level));
+  level.version = 2;
+  level.width = width;
+  level.height = height;
+  level.dest[0] = height - 1;
+  level.dest[1] = width - 1;
+  level.fields = fields;
+  bool loaded = game_init(game, &level);
+  free(fields);
+  if (loaded)
+  {
+    game_end_turn(game);
+  }
+  return loaded;
+}
+
+// ----------------------------------------------------------------------------
+static void bench_load(Bench* bench)
+{
+  LevelPack pack;
+  Level level;
+  Game game;
+  if (level_pack_open(&pack, bench->path) == LEVEL_OK)
+  {
+    if (level_pack_get(&pack, bench->index, &level) == LEVEL_OK)
+    {
+      if (game_init(&game, &level))
+      {
+        game_free(&game);
+      }
+      level_close(&level);
+    }
+    level_pack_close(&pack);
+  }
+}
+
+// ----------------------------------------------------------------------------
+static void bench_solve(Bench* bench)
+{
+  Solution solution;
+  if (solver_solve(bench->game, false, &solution) == SOLVER_OK)
+  {
+    solution_free(&solution);
+  }
+}
+
+// ----------------------------------------------------------------------------
+static void bench_solve_parallel(Bench* bench)
+{
+  Solution solution;
+  if (solver_solve_parallel(bench->game, bench->threads, false, &solution) == SOLVER_OK)
+  {
+    solution_free(&solution);
+  }
+}
+
+// ----------------------------------------------------------------------------
+static void bench_rotate(Bench* bench)
+{
+  uint32_t row;
+  uint32_t col;
+  if (random_field(bench->game, &row, &col))
+  {
+    game_rotate(bench->game, row, col, 1 + 2 * random_below(2));
+    game_end_turn(bench->game);
+  }
+}
+
+// ----------------------------------------------------------------------------
+// Rotates a field and back, on the comb every field is connected to the
+// start pipe
+//
+static void bench_rotate_reached(Bench* bench)
+{
+  uint32_t row;
+  uint32_t col;
+  if (random_field(bench->game, &row, &col))
+  {
+    game_rotate(bench->game, row, col, 1);
+    game_end_turn(bench->game);
+    game_rotate(bench->game, row, col, 3);
+    game_end_turn(bench->game);
+  }
+}
+
+// ----------------------------------------------------------------------------
+static void bench_rebuild(Bench* bench)
+{
+  Grid* grid = &bench->game->grid;
+  rebuild_every_connection(grid->fields, grid->height, grid->width);
+}
+
+// ----------------------------------------------------------------------------
+static void bench_rebuild_scalar(Bench* bench)
+{
+  Grid* grid = &bench->game->grid;
+  rebuild_every_connection_scalar(grid->fields, grid->height, grid->width);
+}
+
+// ----------------------------------------------------------------------------
+static void bench_connected(Bench* bench)
+{
+  Game* game = bench->game;
+  arePipesConnected(game->grid.rows, game->grid.width, game->grid.height, game->start, game->dest);
+}
+
+// ----------------------------------------------------------------------------
+static void bench_print(Bench* bench)
+{
+  Game* game = bench->game;
+  printMap(game->grid.rows, game->grid.width, game->grid.height, game->start, game->dest);
+}
+
+// ----------------------------------------------------------------------------
+// One turn of the game with the output of the interactive mode: a rotation,
+// the map and the prompt
+//
+static void bench_turn(Bench* bench)
+{
+  Game* game = bench->game;
+  bench_rotate(bench);
+  printMap(game->grid.rows, game->grid.width, game->grid.height, game->start, game->dest);
+  printf(INPUT_PROMPT, (unsigned) game->turn);
+}
+
+// ----------------------------------------------------------------------------
+// Applies the commands like the batch mode does, without the output
+//
+static void bench_replay(Bench* bench)
+{
+  Command cmmd;
+  size_t direction;
+  uint32_t row;
+  uint32_t col;
+  char line[64];
+  game_restart(bench->game);
+  for (size_t i = 0; i < bench->count; i++)
+  {
+    // parseCommand works in place
+    strcpy(line, bench->commands[i]);
+    if (parseCommand(line, &cmmd, &direction, &row, &col) == NULL && cmmd == ROTATE)
+    {
+      game_rotate(bench->game, row - 1, col - 1, direction);
+    }
+    game_end_turn(bench->game);
+    game_is_solved(bench->game);
+  }
+}
+
+// ----------------------------------------------------------------------------
+// Runs a benchmark until it took at least BENCH_MIN_NS and prints the result
+//
+// @param name    name in the result line
+// @param run     the benchmark
+// @param bench   its arguments
+// @param ops     operations done by one call of <run>
+//
+static void measure(const char* name, void (*run)(Bench*), Bench* bench, size_t ops)
+{
+  size_t calls = 1;
+  double elapsed = 0;
+  double writes = 0;
+  run(bench);   // warm up caches and scratch memory
+  while (true)
+  {
+    // the output kept in buffers is counted with the run that made it
+    fflush(stdout);
+    writes = count_writes();
+    double begin = now_ns();
+    for (size_t i = 0; i < calls; i++)
+    {
+      run(bench);
+    }
+    elapsed = now_ns() - begin;
+    fflush(stdout);
+    writes = (writes < 0) ? -1 : count_writes() - writes;
+    if (elapsed >= BENCH_MIN_NS)
+    {
+      break;
+    }
+    calls *= 2;
+  }
+  double total = (double) calls * ops;
+  char per_op[24];
+  if (writes < 0)
+  {
+    snprintf(per_op, sizeof(per_op), "-");
+  }
+  else
+  {
+    snprintf(per_op, sizeof(per_op), "%.3f", writes / total);
+  }
+  fprintf(results, BENCH_RESULT, name, bench->game->grid.width, bench->game->grid.height,
+    calls * ops, elapsed / total, total * 1e9 / elapsed, per_op);
+}
+
+// ----------------------------------------------------------------------------
+static void free_commands(char** commands, size_t count)
+{
+  for (size_t i = 0; i < count; i++)
+  {
+    free(commands[i]);
+  }
+  free(commands);
+}
+
+// ----------------------------------------------------------------------------
+// Builds <count> random rotate commands in the format typed by the user
+//
+static char** build_commands(const Game* game, size_t count)
+{
+  char** commands = (char**) malloc(count * sizeof(char*));
+  if (commands == NULL)
+  {
+    return NULL;
+  }
+  for (size_t i = 0; i < count; i++)
+  {
+    uint32_t row = 0;
+    uint32_t col = 0;
+    random_field(game, &row, &col);
+    commands[i] = (char*) malloc(64);
+    if (commands[i] == NULL)
+    {
+      free_commands(commands, i);
+      return NULL;
+    }
+    snprintf(commands[i], 64, "rotate %s %u %u", random_below(2) ? "left" : "right", row + 1, col + 1);
+  }
+  return commands;
+}
+
+// ----------------------------------------------------------------------------
+// Prints why a config file or level pack can not be benchmarked
+//
+// @return  exit code of the program
+//
+static int report_error(LevelError error, const char* path)
+{
+  switch (error)
+  {
+    case LEVEL_OK:
+      break;
+    case LEVEL_ERROR_OPEN:
+      fprintf(results, ERROR_OPEN_FILE, path);
+      return 2;
+    case LEVEL_ERROR_INVALID:
+      fprintf(results, ERROR_INVALID_FILE, path);
+      return 3;
+    case LEVEL_ERROR_MEMORY:
+      fprintf(results, "%s", ERROR_OUT_OF_MEMORY);
+      return 4;
+  }
+  return 0;
+}
+
+// ----------------------------------------------------------------------------
+// Runs every benchmark on one level of a pack or config file
+//
+// @param path    path of the pack, opened again by the load benchmark
+// @param pack    the opened pack
+// @param index   the level, starting at 0
+// @return        exit code of the program
+//
+static int bench_level(const char* path, const LevelPack* pack, uint32_t index)
+{
+  Level level;
+  Game game;
+  char name[48];
+  LevelError error = level_pack_get(pack, index, &level);
+  if (error != LEVEL_OK)
+  {
+    return report_error(error, path);
+  }
+  bool loaded = game_init(&game, &level);
+  level_close(&level);
+  if (!loaded)
+  {
+    fprintf(results, "%s", ERROR_OUT_OF_MEMORY);
+    return 4;
+  }
+  game_end_turn(&game);
+
+  Bench bench = { path, index, &game, NULL, 0, 0 };
+  measure("load", bench_load, &bench, 1);
+  // before rotate, which scrambles the map
+  measure("solve", bench_solve, &bench, 1);
+  // the speedup over the thread count, up to one thread per processor
+  long online = sysconf(_SC_NPROCESSORS_ONLN);
+  size_t processors = (online > 0) ? (size_t) online : 1;
+  for (bench.threads = 1; bench.threads < 2 * processors; bench.threads *= 2)
+  {
+    bench.threads = (bench.threads > processors) ? processors : bench.threads;
+    snprintf(name, sizeof(name), "solve_threads_%zu", bench.threads);
+    measure(name, bench_solve_parallel, &bench, 1);
+  }
+  measure("rotate", bench_rotate, &bench, 1);
+  measure("rebuild", bench_rebuild, &bench, 1);
+  measure("rebuild_scalar", bench_rebuild_scalar, &bench, 1);
+  measure("connected", bench_connected, &bench, 1);
+  measure("print", bench_print, &bench, 1);
+  // the output policies of initOutput, each on a new stream to /dev/null
+  for (int interactive = 0; interactive <= 1; interactive++)
+  {
+    if (freopen("/dev/null", "w", stdout) == NULL)
+    {
+      break;
+    }
+    initOutput(interactive);
+    measure(interactive ? "turn_tty" : "turn_piped", bench_turn, &bench, 1);
+  }
+  // the same size fully connected, where a rotation can cut off many fields
+  Game comb;
+  if (comb_init(&comb, game.grid.width, game.grid.height))
+  {
+    Bench connected = { path, index, &comb, NULL, 0, 0 };
+    measure("comb_rotate", bench_rotate_reached, &connected, 2);
+    game_free(&comb);
+  }
+  for (size_t i = 0; i < sizeof(REPLAY_COMMANDS) / sizeof(REPLAY_COMMANDS[0]); i++)
+  {
+    bench.count = REPLAY_COMMANDS[i];
+    bench.commands = build_commands(&game, bench.count);
+    if (bench.commands == NULL)
+    {
+      break;
+    }
+    snprintf(name, sizeof(name), "replay_%zu", bench.count);
+    measure(name, bench_replay, &bench, bench.count);
+    free_commands(bench.commands, bench.count);
+  }
+
+  game_free(&game);
+  return 0;
+}
+
+// ----------------------------------------------------------------------------
+// Runs every benchmark on a config file, or on every level of a level pack
+//
+// @return  exit code of the program
+//
+static int bench_config(const char* path)
+{
+  LevelPack pack;
+  LevelError error = level_pack_open(&pack, path);
+  if (error != LEVEL_OK)
+  {
+    return report_error(error, path);
+  }
+  int result = 0;
+  for (uint32_t index = 0; index < pack.count && result == 0; index++)
+  {
+    result = bench_level(path, &pack, index);
+  }
+  level_pack_close(&pack);
+  return result;
+}
+
+int main(int argc, char const **argv)
+{
+  if (argc < 2)
+  {
+    printf("%s", USAGE_BENCH);
+    return 1;
+  }
+
+  // the results go to the original stdout, the maps printed while
+  // benchmarking printMap are thrown away
+  fflush(stdout);
+  results = fdopen(dup(STDOUT_FILENO), "w");
+  if (results == NULL || freopen("/dev/null", "w", stdout) == NULL)
+  {
+    return 2;
+  }
+
+  fprintf(results, "%s", BENCH_HEADER);
+  int result = 0;
+  for (int i = 1; i < argc && result == 0; i++)
+  {
+    result = bench_config(argv[i]);
+    fflush(results);
+  }
+  fclose(results);
+  return result;
+}
@@ -0,0 +1,291 @@
+#include <stdlib.h>
+
+#include "connectivity.h"
+
+#define REACH_WORD(index) ((index) / 64)
+#define REACH_BIT(index)  ((uint64_t) 1 << ((index) % 64))
+
+// ----------------------------------------------------------------------------
+static bool is_reached(const Reachability* reach, uint32_t index)
+{
+  return (reach->reached[REACH_WORD(index)] & REACH_BIT(index)) != 0;
+}
+
+// ----------------------------------------------------------------------------
+static void set_position(Reachability* reach, uint32_t index, size_t position)
+{
+  reach->cells[position] = index;
+  reach->positions[index] = (uint32_t) position;
+}
+
+// ----------------------------------------------------------------------------
+// Adds a field to the set, a field that was cut off by the running update is
+// taken out of cells[<count>..<end>) first
+//
+// @param side  connection bit of the field towards the one it was reached
+//              from, 0 for the start pipe
+//
+static void add_reached(Reachability* reach, uint32_t index, uint8_t side)
+{
+  reach->reached[REACH_WORD(index)] |= REACH_BIT(index);
+  reach->parents[index] = side;
+  size_t position = reach->positions[index];
+  if (position >= reach->count && position < reach->end && reach->cells[position] == index)
+  {
+    set_position(reach, reach->cells[reach->count], position);
+  }
+  else if (reach->end > reach->count)
+  {
+    set_position(reach, reach->cells[reach->count], reach->end++);
+  }
+  else
+  {
+    reach->end++;
+  }
+  set_position(reach, index, reach->count++);
+}
+
+// ----------------------------------------------------------------------------
+// Takes a field out of the set, it is put in front of the fields that were
+// cut off before it, at cells[<count>]
+//
+static void remove_reached(Reachability* reach, uint32_t index)
+{
+  reach->reached[REACH_WORD(index)] &= ~REACH_BIT(index);
+  size_t last = --reach->count;
+  set_position(reach, reach->cells[last], reach->positions[index]);
+  set_position(reach, index, last);
+}
+
+// ----------------------------------------------------------------------------
+// Adds the fields a reached field connects to
+//
+static void visit(Reachability* reach, uint8_t** map, uint32_t index)
+{
+  uint32_t width = reach->width;
+  uint32_t row = index / width;
+  uint32_t col = index % width;
+  uint8_t value = map[row][col];
+
+  if ((value & 64) && row > 0 && !is_reached(reach, index - width))
+  {
+    add_reached(reach, index - width, 4);
+  }
+  if ((value & 16) && col > 0 && !is_reached(reach, index - 1))
+  {
+    add_reached(reach, index - 1, 1);
+  }
+  if ((value & 4) && row < reach->height - 1 && !is_reached(reach, index + width))
+  {
+    add_reached(reach, index + width, 64);
+  }
+  if ((value & 1) && col < width - 1 && !is_reached(reach, index + 1))
+  {
+    add_reached(reach, index + 1, 16);
+  }
+}
+
+// ----------------------------------------------------------------------------
+// Walks the connections of every field from cells[<first>] onwards and adds
+// the fields they lead to until no new field is found
+//
+static void flood_from(Reachability* reach, uint8_t** map, size_t first)
+{
+  for (size_t next = first; next < reach->count; ++next)
+  {
+    visit(reach, map, reach->cells[next]);
+  }
+}
+
+// ----------------------------------------------------------------------------
+// @return  connection bit of a field towards a reached neighbour, 0 if it
+//          does not connect to the set
+//
+static uint8_t reached_side(const Reachability* reach, uint8_t** map, uint32_t index)
+{
+  uint32_t width = reach->width;
+  uint32_t row = index / width;
+  uint32_t col = index % width;
+  uint8_t value = map[row][col];
+
+  if ((value & 64) && row > 0 && is_reached(reach, index - width))
+  {
+    return 64;
+  }
+  if ((value & 16) && col > 0 && is_reached(reach, index - 1))
+  {
+    return 16;
+  }
+  if ((value & 4) && row < reach->height - 1 && is_reached(reach, index + width))
+  {
+    return 4;
+  }
+  if ((value & 1) && col < width - 1 && is_reached(reach, index + 1))
+  {
+    return 1;
+  }
+  return 0;
+}
+
+// ----------------------------------------------------------------------------
+// Takes the fields that were reached through a field out of the set
+//
+static void remove_children(Reachability* reach, uint32_t index)
+{
+  uint32_t width = reach->width;
+  uint32_t row = index / width;
+  uint32_t col = index % width;
+
+  if (row > 0 && is_reached(reach, index - width) && reach->parents[index - width] == 4)
+  {
+    remove_reached(reach, index - width);
+  }
+  if (col > 0 && is_reached(reach, index - 1) && reach->parents[index - 1] == 1)
+  {
+    remove_reached(reach, index - 1);
+  }
+  if (row < reach->height - 1 && is_reached(reach, index + width) && reach->parents[index + width] == 64)
+  {
+    remove_reached(reach, index + width);
+  }
+  if (col < width - 1 && is_reached(reach, index + 1) && reach->parents[index + 1] == 16)
+  {
+    remove_reached(reach, index + 1);
+  }
+}
+
+// ----------------------------------------------------------------------------
+bool reachability_init(Reachability* reach, uint8_t** map, uint32_t width, uint32_t height, uint32_t start[2], uint32_t dest[2])
+{
+  size_t fields = (size_t) width * height;
+  reach->width = width;
+  reach->height = height;
+  reach->start[0] = start[0];
+  reach->start[1] = start[1];
+  reach->dest[0] = dest[0];
+  reach->dest[1] = dest[1];
+  reach->count = 0;
+  reach->end = 0;
+  reach->reached = (uint64_t*) calloc(fields / 64 + 1, sizeof(uint64_t));
+  reach->cells = (uint32_t*) malloc(fields * sizeof(uint32_t));
+  reach->parents = (uint8_t*) malloc(fields);
+  // read before they are first written, see add_reached
+  reach->positions = (uint32_t*) calloc(fields, sizeof(uint32_t));
+  if (reach->reached == NULL || reach->cells == NULL || reach->parents == NULL || reach->positions == NULL)
+  {
+    reachability_free(reach);
+    return false;
+  }
+  reachability_reset(reach, map);
+  return true;
+}
+
+// ----------------------------------------------------------------------------
+void reachability_free(Reachability* reach)
+{
+  free(reach->reached);
+  free(reach->cells);
+  free(reach->parents);
+  free(reach->positions);
+  reach->reached = NULL;
+  reach->cells = NULL;
+  reach->parents = NULL;
+  reach->positions = NULL;
+  reach->count = 0;
+  reach->end = 0;
+}
+
+// ----------------------------------------------------------------------------
+void reachability_reset(Reachability* reach, uint8_t** map)
+{
+  // only the reached fields have to be cleared, not the whole bitset
+  for (size_t i = 0; i < reach->count; ++i)
+  {
+    reach->reached[REACH_WORD(reach->cells[i])] = 0;
+  }
+  reach->count = 0;
+  reach->end = 0;
+  add_reached(reach, reach->start[0] * reach->width + reach->start[1], 0);
+  flood_from(reach, map, 0);
+}
+
+// ----------------------------------------------------------------------------
+void reachability_update(Reachability* reach, uint8_t** map, uint32_t row, uint32_t col)
+{
+  uint32_t width = reach->width;
+  uint32_t index = row * width + col;
+  reach->end = reach->count;
+  if (!is_reached(reach, index))
+  {
+    // the pipe was not reached before, so it can only join the set through a
+    // neighbour that now connects to it
+    uint8_t side = reached_side(reach, map, index);
+    if (side != 0)
+    {
+      size_t first = reach->count;
+      add_reached(reach, index, side);
+      flood_from(reach, map, first);
+    }
+    reach->end = reach->count;
+    return;
+  }
+
+  // the rotation cuts off the fields that were reached through a connection
+  // it removed: the pipe itself if it lost the one to its parent, otherwise
+  // the children it lost
+  uint8_t value = map[row][col];
+  uint8_t parent = reach->parents[index];
+  if (parent != 0 && !(value & parent))
+  {
+    remove_reached(reach, index);
+  }
+  else
+  {
+    if (!(value & 64) && row > 0 && is_reached(reach, index - width) && reach->parents[index - width] == 4)
+    {
+      remove_reached(reach, index - width);
+    }
+    if (!(value & 16) && col > 0 && is_reached(reach, index - 1) && reach->parents[index - 1] == 1)
+    {
+      remove_reached(reach, index - 1);
+    }
+    if (!(value & 4) && row < reach->height - 1 && is_reached(reach, index + width) && reach->parents[index + width] == 64)
+    {
+      remove_reached(reach, index + width);
+    }
+    if (!(value & 1) && col < width - 1 && is_reached(reach, index + 1) && reach->parents[index + 1] == 16)
+    {
+      remove_reached(reach, index + 1);
+    }
+  }
+  // and everything below them, cells[<count>..<end>) holds the cut fields
+  for (size_t next = reach->end; next > reach->count;)
+  {
+    remove_children(reach, reach->cells[--next]);
+  }
+
+  // a cut field that still connects to the set joins it again, the flood
+  // fill brings back the fields behind it and the new connections of the pipe
+  size_t first = reach->count;
+  for (size_t next = reach->count; next < reach->end; ++next)
+  {
+    uint32_t cut = reach->cells[next];
+    uint8_t side = reached_side(reach, map, cut);
+    if (side != 0)
+    {
+      add_reached(reach, cut, side);
+    }
+  }
+  if (is_reached(reach, index))
+  {
+    visit(reach, map, index);
+  }
+  flood_from(reach, map, first);
+  reach->end = reach->count;
+}
+
+// ----------------------------------------------------------------------------
+bool reachability_is_connected(const Reachability* reach)
+{
+  return is_reached(reach, reach->dest[0] * reach->width + reach->dest[1]);
+}
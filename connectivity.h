@@ -0,0 +1,87 @@
+#ifndef CONNECTIVITY_H
+#define CONNECTIVITY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// ----------------------------------------------------------------------------
+// Set of fields that are connected to the start pipe
+//
+// The set is kept up to date while the game is running, so checking whether
+// start- and dest-pipe are connected does not need to walk the map again.
+// <cells> holds every reached field and doubles as the queue of the flood
+// fill, <positions> is the index of a field in <cells> and <reached> is the
+// same set as a bitset. <parents> is the connection bit of every reached
+// field towards the field it was reached from, which makes the flood fill a
+// tree. During an update, cells[<count>..<end>) holds the fields that were
+// cut off from the set.
+//
+typedef struct _Reachability_
+{
+  uint32_t width;
+  uint32_t height;
+  uint32_t start[2];
+  uint32_t dest[2];
+  uint64_t* reached;
+  uint32_t* cells;
+  uint32_t* positions;
+  uint8_t* parents;
+  size_t count;
+  size_t end;
+} Reachability;
+
+// ----------------------------------------------------------------------------
+// Allocates the set and fills it with every field connected to the start pipe
+//
+// @param reach   the set to initialise
+// @param map     the game map
+// @param width   the maps width
+// @param height  the maps height
+// @param start   row and column of start pipe
+// @param dest    row and column of dest pipe
+// @return        false if out of memory, otherwise true
+//
+bool reachability_init(Reachability* reach, uint8_t** map, uint32_t width, uint32_t height, uint32_t start[2], uint32_t dest[2]);
+
+// ----------------------------------------------------------------------------
+// Frees the memory of the set
+//
+// @param reach   the set
+//
+void reachability_free(Reachability* reach);
+
+// ----------------------------------------------------------------------------
+// Rebuilds the set from scratch, e.g. after the connections of the whole map
+// were rebuilt
+//
+// @param reach   the set
+// @param map     the game map
+//
+void reachability_reset(Reachability* reach, uint8_t** map);
+
+// ----------------------------------------------------------------------------
+// Updates the set after a single pipe was rotated
+//
+// Expects the connections of the rotated pipe and its neighbours to be up to
+// date already. A pipe outside of the set can only add fields to it, which
+// costs O(1) plus the newly reached fields. Rotating a pipe inside of the set
+// cuts off the fields that were reached through a connection it lost; only
+// those are flooded again, from the ones that still connect to the set.
+//
+// @param reach   the set
+// @param map     the game map
+// @param row     row of the rotated pipe (starting at 0)
+// @param col     column of the rotated pipe (starting at 0)
+//
+void reachability_update(Reachability* reach, uint8_t** map, uint32_t row, uint32_t col);
+
+// ----------------------------------------------------------------------------
+// Checks if start- and dest-pipe are connected
+//
+// @param reach   the set
+// @return        true if connected, otherwise false
+//
+bool reachability_is_connected(const Reachability* reach);
+
+#endif
@@ -1,330 +1,540 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <ctype.h>
+#include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <ctype.h>
+#include <unistd.h>
 
 #include "framework.h"
 
-#define FRAMEWORK_GETLINE_BUFSIZE 16 * sizeof(char)
 #define FRAMEWORK_COORD_TO_INDEX(width, row, col) (width * row + col)
 
+// every glyph of the map is a 3 byte UTF-8 sequence
+#define FRAMEWORK_GLYPH_SIZE 3
+
+#define GLYPH_INVALID "▞"
+#define GLYPH_VERTICAL_LINE "│"
+#define GLYPH_HORIZONTAL_LINE "─"
+#define GLYPH_CROSS "┼"
+
+// ----------------------------------------------------------------------------
+// Glyphs of every field value, indexed by the open sides of the pipe
+// (value & 0xAA), so the connection bits do not need to be masked out again.
+static const char PIPE_GLYPHS[256][FRAMEWORK_GLYPH_SIZE + 1] =
+{
+  [0x00u] = "█", [0x02u] = GLYPH_INVALID, [0x08u] = GLYPH_INVALID, [0x0Au] = "╔",
+  [0x20u] = GLYPH_INVALID, [0x22u] = "═", [0x28u] = "╗", [0x2Au] = "╦",
+  [0x80u] = GLYPH_INVALID, [0x82u] = "╚", [0x88u] = "║", [0x8Au] = "╠",
+  [0xA0u] = "╝", [0xA2u] = "╩", [0xA8u] = "╣", [0xAAu] = "╬"
+};
+
+static const char SPECIAL_PIPE_GLYPHS[256][FRAMEWORK_GLYPH_SIZE + 1] =
+{
+  [0x00u] = GLYPH_INVALID, [0x02u] = "╞", [0x08u] = "╥", [0x0Au] = GLYPH_INVALID,
+  [0x20u] = "╡", [0x22u] = GLYPH_INVALID, [0x28u] = GLYPH_INVALID, [0x2Au] = GLYPH_INVALID,
+  [0x80u] = "╨", [0x82u] = GLYPH_INVALID, [0x88u] = GLYPH_INVALID, [0x8Au] = GLYPH_INVALID,
+  [0xA0u] = GLYPH_INVALID, [0xA2u] = GLYPH_INVALID, [0xA8u] = GLYPH_INVALID, [0xAAu] = GLYPH_INVALID
+};
+
+// ----------------------------------------------------------------------------
+// Buffer of stdout when it is not a terminal, see initOutput
+static char output_buffer[FRAMEWORK_OUTPUT_SIZE];
+
+// ----------------------------------------------------------------------------
+// Frame buffer of printMap, kept per thread and only grown when a bigger map
+// is printed
+static _Thread_local char* frame_buffer = NULL;
+static _Thread_local size_t frame_capacity = 0;
+
 // ----------------------------------------------------------------------------
 char* pipeToChar(uint8_t pipe)
 {
-  switch (pipe & 0xAAu)
-  {
-    case 0xAAu:
-      return "╬";
-    case 0x2Au:
-      return "╦";
-    case 0x8Au:
-      return "╠";
-    case 0xA2u:
-      return "╩";
-    case 0xA8u:
-      return "╣";
-    case 0x88u:
-      return "║";
-    case 0x22u:
-      return "═";
-    case 0xA0u:
-      return "╝";
-    case 0x28u:
-      return "╗";
-    case 0x0Au:
-      return "╔";
-    case 0x82u:
-      return "╚";
-    case 0x0u:
-      return "█";
-    default:
-      return "▞"; // invalid value
-  }
+  return (char*) PIPE_GLYPHS[pipe & 0xAAu];
 }
 
 // ----------------------------------------------------------------------------
 char* specialPipeToChar(uint8_t pipe)
 {
-  switch (pipe & 0xAAu)
-  {
-    case 0x80u:
-      return "╨";
-    case 0x20u:
-      return "╡";
-    case 0x08u:
-      return "╥";
-    case 0x02u:
-      return "╞";
-    default:
-      return "▞"; // invalid value
-  }
+  return (char*) SPECIAL_PIPE_GLYPHS[pipe & 0xAAu];
 }
 
 // ----------------------------------------------------------------------------
-uint8_t getNumberOfDigits(uint8_t number)
+uint8_t getNumberOfDigits(uint32_t number)
 {
-  if (number == 0)
+  uint8_t digits = 0;
+  for (; number != 0; number /= 10)
   {
-    return number;
+    ++digits;
   }
-  return 1 + getNumberOfDigits(number / 10);
+  return digits;
 }
 
 // ----------------------------------------------------------------------------
-uint8_t power(uint8_t base, uint8_t exponent)
+static char* appendGlyph(char* out, const char* glyph)
 {
-  if (exponent == 0)
-  {
-    return 1;
-  }
-  else if (exponent == 1)
-  {
-    return base;
-  }
-  else
-  {
-    return base * power(base, --exponent);
-  }
+  memcpy(out, glyph, FRAMEWORK_GLYPH_SIZE);
+  return out + FRAMEWORK_GLYPH_SIZE;
 }
 
 // ----------------------------------------------------------------------------
-void printMap(uint8_t** map, uint8_t width, uint8_t height, uint8_t start[2], uint8_t dest[2])
+const char* formatMap(uint8_t** map, uint32_t width, uint32_t height, uint32_t start[2], uint32_t dest[2], size_t* length)
 {
   uint8_t num_digits_row = getNumberOfDigits(height);
   uint8_t num_digits_col = getNumberOfDigits(width);
 
-  printf("\n");
-
-  // print column header
-  for (uint8_t i = 0; i < num_digits_col; ++i)
+  // column header, separator and rows, each with the row header in front
+  size_t line_size = num_digits_row + FRAMEWORK_GLYPH_SIZE + 1;
+  size_t size = 2 + num_digits_col * (line_size + width)
+    + (num_digits_row + 1 + width) * FRAMEWORK_GLYPH_SIZE + 1
+    + height * (line_size + (size_t) width * FRAMEWORK_GLYPH_SIZE);
+  if (size > frame_capacity)
   {
-    for (uint8_t j = 0; j < num_digits_row; ++j)
+    char* grown = (char*) realloc(frame_buffer, size);
+    if (grown == NULL)
     {
-      printf(" ");
+      return NULL;
     }
-    printf("│");
-    for (uint8_t j = 1; j <= width; ++j)
+    frame_buffer = grown;
+    frame_capacity = size;
+  }
+  char* out = frame_buffer;
+
+  *out++ = '\n';
+
+  // print column header
+  uint32_t divisor = 1;
+  for (uint8_t i = 1; i < num_digits_col; ++i)
+  {
+    divisor *= 10;
+  }
+  for (uint8_t i = 0; i < num_digits_col; ++i, divisor /= 10)
+  {
+    memset(out, ' ', num_digits_row);
+    out = appendGlyph(out + num_digits_row, GLYPH_VERTICAL_LINE);
+    for (uint32_t j = 1; j <= width; ++j)
     {
-      uint8_t digit = j / power(10, (num_digits_col - i - 1)) % 10;
-      printf("%u", digit);
+      *out++ = (char) ('0' + j / divisor % 10);
     }
-    printf("\n");
+    *out++ = '\n';
   }
 
   // print horizontal seperator
   for (uint8_t i = 0; i < num_digits_row; ++i)
   {
-    printf("─");
+    out = appendGlyph(out, GLYPH_HORIZONTAL_LINE);
   }
-  printf("┼");
-  for (uint8_t i = 0; i < width; ++i)
+  out = appendGlyph(out, GLYPH_CROSS);
+  for (uint32_t i = 0; i < width; ++i)
   {
-    printf("─");
+    out = appendGlyph(out, GLYPH_HORIZONTAL_LINE);
   }
-  printf("\n");
+  *out++ = '\n';
 
   // print row header and map
-  for (uint8_t row = 0; row < height; ++row)
+  for (uint32_t row = 0; row < height; ++row)
   {
-    printf("%0*u│", num_digits_row, row + 1);
-    for (uint8_t col = 0; col < width; ++col)
+    uint32_t number = row + 1;
+    for (uint8_t i = num_digits_row; i > 0; --i, number /= 10)
     {
-      if ((row == start[0] && col == start[1]) || (row == dest[0] && col == dest[1]))
-      {
-        printf("%s", specialPipeToChar(map[row][col]));
-      }
-      else
-      {
-        printf("%s", pipeToChar(map[row][col]));
-      }
+      out[i - 1] = (char) ('0' + number % 10);
+    }
+    out = appendGlyph(out + num_digits_row, GLYPH_VERTICAL_LINE);
+    const uint8_t* fields = map[row];
+    for (uint32_t col = 0; col < width; ++col)
+    {
+      out = appendGlyph(out, PIPE_GLYPHS[fields[col] & 0xAAu]);
     }
-    printf("\n");
+    *out++ = '\n';
   }
-  printf("\n");
+  *out++ = '\n';
+
+  // start and dest pipe use their own glyphs
+  size_t first_row = 1 + num_digits_col * (line_size + width)
+    + (num_digits_row + 1 + width) * FRAMEWORK_GLYPH_SIZE + 1;
+  size_t row_size = line_size + (size_t) width * FRAMEWORK_GLYPH_SIZE;
+  for (uint8_t i = 0; i < 2; ++i)
+  {
+    uint32_t* special = (i == 0) ? start : dest;
+    appendGlyph(frame_buffer + first_row + special[0] * row_size + num_digits_row + FRAMEWORK_GLYPH_SIZE
+      + (size_t) special[1] * FRAMEWORK_GLYPH_SIZE, SPECIAL_PIPE_GLYPHS[map[special[0]][special[1]] & 0xAAu]);
+  }
+
+  *length = (size_t) (out - frame_buffer);
+  return frame_buffer;
 }
 
 // ----------------------------------------------------------------------------
-bool arePipesConnectedM(uint8_t** map, int8_t* path, uint8_t width, uint8_t height, uint8_t coord[2], uint8_t val)
+void printMap(uint8_t** map, uint32_t width, uint32_t height, uint32_t start[2], uint32_t dest[2])
 {
-  if (path[FRAMEWORK_COORD_TO_INDEX(width, coord[0], coord[1])] == -1)
+  size_t length = 0;
+  const char* frame = formatMap(map, width, height, start, dest, &length);
+  if (frame == NULL)
+  {
+    printf("%s", ERROR_OUT_OF_MEMORY);
+    return;
+  }
+  fwrite(frame, 1, length, stdout);
+}
+
+// ----------------------------------------------------------------------------
+// Scratch memory of arePipesConnected, kept per thread and only grown when a
+// bigger map is checked. <visited> is a bitset of the fields already queued,
+// <queue> holds those fields in the order they were found.
+static _Thread_local uint64_t* connected_visited = NULL;
+static _Thread_local uint32_t* connected_queue = NULL;
+static _Thread_local size_t connected_capacity = 0;
+
+// ----------------------------------------------------------------------------
+static bool reserveConnectedScratch(size_t fields)
+{
+  if (fields <= connected_capacity)
   {
     return true;
   }
-  path[FRAMEWORK_COORD_TO_INDEX(width, coord[0], coord[1])] = val;
+  free(connected_visited);
+  free(connected_queue);
+  connected_visited = (uint64_t*) calloc(fields / 64 + 1, sizeof(uint64_t));
+  connected_queue = (uint32_t*) malloc(fields * sizeof(uint32_t));
+  if (connected_visited == NULL || connected_queue == NULL)
+  {
+    free(connected_visited);
+    free(connected_queue);
+    connected_visited = NULL;
+    connected_queue = NULL;
+    connected_capacity = 0;
+    return false;
+  }
+  connected_capacity = fields;
+  return true;
+}
+
+// ----------------------------------------------------------------------------
+bool arePipesConnected(uint8_t** map, uint32_t width, uint32_t height, uint32_t start[2], uint32_t dest[2])
+{
+  if (!reserveConnectedScratch((size_t) width * height))
+  {
+    return false;
+  }
+  uint64_t* visited = connected_visited;
+  uint32_t* queue = connected_queue;
+  uint32_t target = FRAMEWORK_COORD_TO_INDEX(width, dest[0], dest[1]);
+  uint32_t first = FRAMEWORK_COORD_TO_INDEX(width, start[0], start[1]);
+  size_t tail = 0;
+  bool is_conn = false;
 
-  for (uint8_t dir = 0; dir < 4; ++dir)
+  visited[first / 64] |= (uint64_t) 1 << (first % 64);
+  queue[tail++] = first;
+  for (size_t head = 0; head < tail; ++head)
   {
-    if (!((dir == 0 && coord[0] == 0) || (dir == 1 && coord[1] == 0)
-      || (dir == 2 && coord[0] >= height - 1) || (dir == 3 && coord[1] >= width - 1))
-      && (map[coord[0]][coord[1]] & (0x1u << 2*(3 - dir))))
+    uint32_t index = queue[head];
+    uint32_t row = index / width;
+    uint32_t col = index % width;
+    if (index == target)
+    {
+      is_conn = true;
+      break;
+    }
+
+    // neighbours in the order up, left, down, right (see README.md#datentypen)
+    uint32_t next[4] = { index - width, index - 1, index + width, index + 1 };
+    bool open[4] = { row > 0, col > 0, row < height - 1u, col < width - 1u };
+    for (uint8_t dir = 0; dir < 4; ++dir)
     {
-      uint8_t new[2];
-      new[0] = (dir % 2 == 0) ? coord[0] + (dir - 1) : coord[0];
-      new[1] = (dir % 2 == 1) ? coord[1] + (dir - 2) : coord[1];
-      if (path[FRAMEWORK_COORD_TO_INDEX(width, new[0], new[1])] <= 0
-        && arePipesConnectedM(map, path, width, height, new, val + 1))
+      if (open[dir] && (map[row][col] & (0x1u << 2*(3 - dir)))
+        && !(visited[next[dir] / 64] & ((uint64_t) 1 << (next[dir] % 64))))
       {
-        return true;
+        visited[next[dir] / 64] |= (uint64_t) 1 << (next[dir] % 64);
+        queue[tail++] = next[dir];
       }
     }
   }
 
-  return false;
+  // only the queued fields were marked, so clearing them leaves a zeroed bitset
+  for (size_t i = 0; i < tail; ++i)
+  {
+    visited[queue[i] / 64] = 0;
+  }
+  return is_conn;
 }
 
 // ----------------------------------------------------------------------------
-bool arePipesConnected(uint8_t** map, uint8_t width, uint8_t height, uint8_t start[2], uint8_t dest[2])
+void freeThreadScratch()
 {
-  //return arePipesConnectedR(map, width, height, start, dest, start);
-  
-  int8_t* path = (int8_t*) calloc(width * height, sizeof(int8_t));
-  path[FRAMEWORK_COORD_TO_INDEX(width, dest[0], dest[1])] = -1;
-  bool is_conn = arePipesConnectedM(map, path, width, height, start, 1);
-  free(path);
-  return is_conn;
+  free(frame_buffer);
+  free(connected_visited);
+  free(connected_queue);
+  frame_buffer = NULL;
+  frame_capacity = 0;
+  connected_visited = NULL;
+  connected_queue = NULL;
+  connected_capacity = 0;
 }
 
 // ----------------------------------------------------------------------------
-char* getLine()
+void initOutput(bool interactive)
 {
-  size_t bufsize = 0;
-  bool has_newline = false;
-  char* line = NULL;
-  char* line_end = NULL;
-
-  clearerr(stdin);
-  while(!(feof(stdin) || has_newline))
+  if (interactive)
   {
-    bufsize += FRAMEWORK_GETLINE_BUFSIZE;
-    char* line_tmp = (char*) realloc(line, bufsize);
-    if (line_tmp == NULL)
-    {
-      free(line);
-      return NULL;
-    }
-    if (line_end == NULL)
-    {
-      line_end = line_tmp;
-      *line_end = '\0';
-    }
-    else
-    {
-      line_end = line_end - line + line_tmp; // recalculate pointer
-    }
-    line = line_tmp;
-
-    fgets(line_end, FRAMEWORK_GETLINE_BUFSIZE, stdin);
-    if ((line_tmp = strchr(line_end, '\n')) != NULL)
-    {
-      has_newline = true;
-      *line_tmp = '\0';
-    }
-    line_end += FRAMEWORK_GETLINE_BUFSIZE - sizeof(char);
+    setvbuf(stdout, NULL, _IOLBF, 0);
   }
-
-  if (feof(stdin))
+  else
   {
-    free(line);
-    return (char*) EOF;
+    setvbuf(stdout, output_buffer, _IOFBF, sizeof(output_buffer));
   }
+}
 
-  return line;
+// ----------------------------------------------------------------------------
+void initReader(LineReader* reader, int fd)
+{
+  reader->fd = fd;
+  reader->start = 0;
+  reader->end = 0;
+  reader->ended = false;
+  reader->skipping = false;
+}
+
+// ----------------------------------------------------------------------------
+// Moves the bytes that were not taken yet to the front and reads as many
+// more as fit
+//
+// @return  false if nothing was read, because the input ended or the buffer
+//          is full
+//
+static bool fillReader(LineReader* reader)
+{
+  if (reader->start > 0)
+  {
+    memmove(reader->buffer, reader->buffer + reader->start, reader->end - reader->start);
+    reader->end -= reader->start;
+    reader->start = 0;
+  }
+  if (reader->ended || reader->end == FRAMEWORK_READER_SIZE)
+  {
+    return false;
+  }
+  // like stdio, the output (e.g. the prompt) is written before waiting for
+  // input
+  fflush(stdout);
+  ssize_t got;
+  do
+  {
+    got = read(reader->fd, reader->buffer + reader->end, FRAMEWORK_READER_SIZE - reader->end);
+  } while (got < 0 && errno == EINTR);
+  if (got <= 0)
+  {
+    reader->ended = true;
+    return false;
+  }
+  reader->end += (size_t) got;
+  return true;
 }
 
 // ----------------------------------------------------------------------------
-bool parseCommandRotate(size_t* dir, uint8_t* row, uint8_t* col)
+char* readLine(LineReader* reader)
 {
-    // parse direction
-    char *token = strtok(NULL, " \t\n");
-    for (size_t i = 0; token != NULL && token[i] != '\0'; ++i)
+  size_t scanned = 0;   // bytes after <start> without a newline
+  while (true)
+  {
+    char* first = reader->buffer + reader->start;
+    char* newline = (char*) memchr(first + scanned, '\n', reader->end - reader->start - scanned);
+    if (newline != NULL)
     {
-      token[i] = tolower(token[i]);
+      reader->start = (size_t) (newline - reader->buffer) + 1;
+      if (reader->skipping)
+      {
+        // the rest of a line that was too long
+        reader->skipping = false;
+        scanned = 0;
+        continue;
+      }
+      *newline = '\0';
+      return first;
     }
-    if (token != NULL && strcmp("left", token) == 0)
+    scanned = reader->end - reader->start;
+    if (reader->skipping)
     {
-      *dir = 1;
+      reader->start = reader->end;
+      scanned = 0;
     }
-    else if (token != NULL && strcmp("right", token) == 0)
+    if (fillReader(reader))
     {
-      *dir = 3;
+      continue;
     }
-    else
+
+    size_t length = reader->end - reader->start;
+    if (length == 0 || reader->skipping)
     {
-      return false;
+      return NULL;
     }
+    // a line that fills the whole buffer is cut, the rest of it is skipped
+    first = reader->buffer + reader->start;
+    first[length] = '\0';
+    reader->start = reader->end;
+    reader->skipping = !reader->ended;
+    return first;
+  }
+}
 
-    // parse row and column
-    token = strtok(NULL, " \t\n");
-    if (token != NULL)
+// ----------------------------------------------------------------------------
+bool readWord(LineReader* reader, char* word, size_t size)
+{
+  size_t length = 0;
+  while (length + 1 < size)
+  {
+    if (reader->start == reader->end && !fillReader(reader))
     {
-      char** token_end = &token;
-      int num = strtol(token, token_end, 10);
-      if (num < 1 || strchr(" \t\n", **token_end) == NULL)
-      {
-        return false;
-      }
-      *row = (uint8_t) num;
-      
-      token = strtok(NULL, " \t\n");
-      if (token != NULL)
+      break;
+    }
+    char byte = reader->buffer[reader->start];
+    if (isspace((unsigned char) byte))
+    {
+      if (length > 0)
       {
-        num = strtol(token, token_end, 10);
-        if (num < 1 || strchr(" \t\n", **token_end) == NULL)
-        {
-          return false;
-        }
-        *col = (uint8_t) num;
-
-        // check for additional parameters
-        token = strtok(NULL, " \t\n");
-        if (token == NULL)
-        {
-          return true;
-        }
+        break;
       }
+      reader->start++;
+      continue;
     }
-    return false;
+    word[length++] = byte;
+    reader->start++;
+  }
+  word[length] = '\0';
+  return length > 0;
 }
 
 // ----------------------------------------------------------------------------
-char* parseCommand(char* line, Command* cmd, size_t* dir, uint8_t* row, uint8_t* col)
+// Takes the next token of a command line and terminates it in place, like
+// strtok_r with the delimiters " \t\n"
+//
+// @param cursor  the rest of the line, moved behind the token
+// @param lower   true to turn the token into lowercase on the way
+// @return        the token, NULL if only delimiters are left
+//
+static char* nextToken(char** cursor, bool lower)
 {
-  char* token = strtok(line, " \t\n");
-  for (size_t i = 0; token != NULL && token[i] != '\0'; ++i)
+  char* token = *cursor;
+  while (*token == ' ' || *token == '\t' || *token == '\n')
   {
-    token[i] = tolower(token[i]);
+    token++;
   }
-
-  if (token == NULL)
+  if (*token == '\0')
   {
-    *cmd = (size_t) NONE;
+    *cursor = token;
+    return NULL;
   }
-  else if (strcmp("rotate", token) == 0)
+  char* end = token;
+  for (; *end != '\0' && *end != ' ' && *end != '\t' && *end != '\n'; end++)
   {
-    bool success = parseCommandRotate(dir, row, col);
-    *cmd = (size_t) ROTATE;
-    if (!success)
+    if (lower)
     {
-      return (char*) 1;
+      *end = (char) tolower((unsigned char) *end);
     }
   }
-  else if (strcmp("help", token) == 0)
+  *cursor = (*end == '\0') ? end : end + 1;
+  *end = '\0';
+  return token;
+}
+
+// ----------------------------------------------------------------------------
+// Parses a row, column or level, the whole token has to be an integer
+// greater than 0 as strtol reads it. Bigger numbers than UINT32_MAX become
+// UINT32_MAX.
+//
+// @return  false if the token is missing or not such a number
+//
+static bool parseNumber(const char* token, uint32_t* number)
+{
+  if (token == NULL)
   {
-    *cmd = (size_t) HELP;
+    return false;
   }
-  else if (strcmp("quit", token) == 0)
+  while (isspace((unsigned char) *token))
   {
-    *cmd = (size_t) QUIT;
+    token++;
   }
-  else if (strcmp("restart", token) == 0)
+  bool negative = *token == '-';
+  token += (*token == '-' || *token == '+') ? 1 : 0;
+  uint64_t value = 0;
+  const char* digits = token;
+  for (; *token >= '0' && *token <= '9'; token++)
   {
-    *cmd = (size_t) RESTART;
+    value = value * 10 + (uint64_t) (*token - '0');
+    value = (value > UINT32_MAX) ? (uint64_t) UINT32_MAX + 1 : value;
   }
-  else // unknown command
+  if (token == digits || *token != '\0' || value == 0 || negative)
   {
-    return token;
+    return false;
+  }
+  *number = (value > UINT32_MAX) ? UINT32_MAX : (uint32_t) value;
+  return true;
+}
+
+// ----------------------------------------------------------------------------
+// Parses the arguments of rotate, see parseCommand
+//
+static bool parseCommandRotate(size_t* dir, uint32_t* row, uint32_t* col, char** cursor)
+{
+  char* token = nextToken(cursor, true);
+  if (token != NULL && strcmp("left", token) == 0)
+  {
+    *dir = 1;
+  }
+  else if (token != NULL && strcmp("right", token) == 0)
+  {
+    *dir = 3;
+  }
+  else
+  {
+    return false;
   }
-  
-  return NULL;
+  return parseNumber(nextToken(cursor, false), row) && parseNumber(nextToken(cursor, false), col)
+    && nextToken(cursor, false) == NULL;
 }
 
+// ----------------------------------------------------------------------------
+// The commands without arguments
+//
+static const struct
+{
+  const char* name;
+  Command command;
+} SIMPLE_COMMANDS[] =
+{
+  { "help", HELP }, { "quit", QUIT }, { "restart", RESTART }, { "undo", UNDO },
+  { "redo", REDO }, { "stats", STATS }, { "solve", SOLVE }
+};
+
+// ----------------------------------------------------------------------------
+char* parseCommand(char* line, Command* cmd, size_t* dir, uint32_t* row, uint32_t* col)
+{
+  char* cursor = line;
+  char* token = nextToken(&cursor, true);
+  if (token == NULL)
+  {
+    *cmd = NONE;
+    return NULL;
+  }
+  if (strcmp("rotate", token) == 0)
+  {
+    *cmd = ROTATE;
+    return parseCommandRotate(dir, row, col, &cursor) ? NULL : (char*) 1;
+  }
+  if (strcmp("level", token) == 0)
+  {
+    *cmd = LEVEL;
+    bool valid = parseNumber(nextToken(&cursor, false), row) && nextToken(&cursor, false) == NULL;
+    return valid ? NULL : (char*) 1;
+  }
+  for (size_t i = 0; i < sizeof(SIMPLE_COMMANDS) / sizeof(SIMPLE_COMMANDS[0]); i++)
+  {
+    if (strcmp(SIMPLE_COMMANDS[i].name, token) == 0)
+    {
+      *cmd = SIMPLE_COMMANDS[i].command;
+      return NULL;
+    }
+  }
+  // unknown command
+  return token;
+}
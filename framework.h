@@ -1,6 +1,16 @@
+#ifndef FRAMEWORK_H
+#define FRAMEWORK_H
+
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
+// bytes of input a LineReader keeps, also the longest line it returns whole
+#define FRAMEWORK_READER_SIZE 65536
+
+// bytes of output kept before writing when stdout is not a terminal
+#define FRAMEWORK_OUTPUT_SIZE 65536
+
 #define USAGE_APPLICATION     "Usage: ./a3 CONFIG_FILE\n"
 #define ERROR_OPEN_FILE       "Error: Cannot open file: %s\n"
 #define ERROR_INVALID_FILE    "Error: Invalid file: %s\n"
@@ -8,13 +18,23 @@
 #define ERROR_UNKNOWN_COMMAND "Error: Unknown command: %s\n"
 #define USAGE_COMMAND_ROTATE  "Usage: rotate ( left | right ) ROW COLUMN\n"
 #define ERROR_ROTATE_INVALID  "Error: Rotating start- or end-pipe is not allowed\n"
+#define USAGE_COMMAND_LEVEL   "Usage: level NUMBER\n"
+#define ERROR_LEVEL_MISSING   "Error: There is no level %u\n"
+#define ERROR_LEVEL_INVALID   "Error: Level %u is invalid\n"
 #define ERROR_NAME_ALPHABETIC "Error: Invalid name. Only alphabetic letters allowed\n"
 #define ERROR_NAME_LENGTH     "Error: Invalid name. Name must be exactly 3 letters long\n"
+#define ERROR_NOTHING_TO_UNDO "Error: Nothing to undo\n"
+#define ERROR_NOTHING_TO_REDO "Error: Nothing to redo\n"
+#define ERROR_NO_SOLUTION     "Error: The pipes can not be connected\n"
 
 #define INPUT_PROMPT "%u > "
 #define INPUT_NAME   "Please enter 3-letter name: "
 
-#define HELP_TEXT "Commands:\n" \
+// the help text is put together from parts, so the server can leave out
+// the commands it does not offer
+#define HELP_TEXT HELP_TEXT_HEAD HELP_TEXT_STATS HELP_TEXT_TAIL
+
+#define HELP_TEXT_HEAD "Commands:\n" \
                   " - rotate <DIRECTION> <ROW> <COLUMN>\n" \
                   "    <DIRECTION> is either `left` or `right`.\n\n" \
                   " - help\n" \
@@ -22,13 +42,27 @@
                   " - quit\n" \
                   "    Terminates the game.\n\n" \
                   " - restart\n" \
-                  "    Restarts the game.\n"
+                  "    Restarts the game.\n\n" \
+                  " - undo\n" \
+                  "    Takes back the last rotation.\n\n" \
+                  " - redo\n" \
+                  "    Repeats the last rotation that was taken back.\n\n"
+#define HELP_TEXT_STATS " - stats\n" \
+                  "    Prints the time spent in every part of a turn.\n\n"
+#define HELP_TEXT_TAIL " - solve\n" \
+                  "    Prints rotations that connect the pipes.\n\n" \
+                  " - level <NUMBER>\n" \
+                  "    Starts level <NUMBER> of the level pack.\n"
 
 #define INFO_PUZZLE_SOLVED  "Puzzle solved!\n"
+#define INFO_PUZZLE_UNSOLVED "Puzzle not solved!\n"
+#define INFO_COMMANDS       "Commands: %zu\n"
 #define INFO_SCORE          "Score: %u\n"
 #define INFO_BEAT_HIGHSCORE "Beat Highscore!\n"
 #define INFO_HIGHSCORE_HEADER "Highscore:\n"
 #define INFO_HIGHSCORE_ENTRY  "   %s %u\n"
+#define INFO_SOLUTION         "Solution with %zu rotations:\n"
+#define INFO_SOLUTION_MOVE    "rotate %s %u %u\n"
 
 typedef enum _Command_
 {
@@ -36,10 +70,55 @@ typedef enum _Command_
   ROTATE,
   HELP,
   QUIT,
-  RESTART
+  RESTART,
+  UNDO,
+  REDO,
+  STATS,
+  SOLVE,
+  LEVEL
 } Command;
 
 
+// ----------------------------------------------------------------------------
+// Gets the glyph of a pipe
+//
+// @param pipe    value of the field
+// @return        the glyph as null-terminated UTF-8 string
+//
+char* pipeToChar(uint8_t pipe);
+
+// ----------------------------------------------------------------------------
+// Gets the glyph of the start- or dest-pipe
+//
+// @param pipe    value of the field
+// @return        the glyph as null-terminated UTF-8 string
+//
+char* specialPipeToChar(uint8_t pipe);
+
+// ----------------------------------------------------------------------------
+// Counts the decimal digits of a number
+//
+// @param number  the number
+// @return        number of digits, 0 for 0
+//
+uint8_t getNumberOfDigits(uint32_t number);
+
+// ----------------------------------------------------------------------------
+// Builds the text printMap prints
+//
+// The text is kept in a buffer per thread, which is reused by the next call
+// in the same thread.
+//
+// @param map     the game map
+// @param width   the maps width
+// @param height  the maps height
+// @param start   row and column of start pipe
+// @param dest    row and column of dest pipe
+// @param length  set to the length of the text
+// @return        the text (not null-terminated), NULL if out of memory
+//
+const char* formatMap(uint8_t** map, uint32_t width, uint32_t height, uint32_t start[2], uint32_t dest[2], size_t* length);
+
 // ----------------------------------------------------------------------------
 // Prints the game map
 //
@@ -49,34 +128,92 @@ typedef enum _Command_
 // @param start   row and column of start pipe
 // @param dest    row and column of dest pipe
 //
-void printMap(uint8_t** map, uint8_t width, uint8_t height, uint8_t start[2], uint8_t dest[2]);
+void printMap(uint8_t** map, uint32_t width, uint32_t height, uint32_t start[2], uint32_t dest[2]);
 
 // ----------------------------------------------------------------------------
 // Checks if start- and dest-pipe are connected
 //
+// Walks the connections with an iterative flood fill. The scratch memory is
+// kept per thread and reused between calls.
+//
 // @param map     the game map
 // @param width   the maps width
 // @param height  the maps height
 // @param start   row and column of start pipe
 // @param dest    row and column of dest pipe
-// @return        true if connected, otherwise false
+// @return        true if connected, otherwise false (also if out of memory)
+//
+bool arePipesConnected(uint8_t** map, uint32_t width, uint32_t height, uint32_t start[2], uint32_t dest[2]);
+
+// ----------------------------------------------------------------------------
+// Frees the buffers formatMap and arePipesConnected keep for the calling
+// thread, e.g. before the thread ends. They are allocated again if needed.
+//
+void freeThreadScratch();
+
+// ----------------------------------------------------------------------------
+// Sets how stdout is buffered, must be called before anything is printed
+//
+// A terminal gets every line as soon as it ends. Otherwise, e.g. when piped,
+// up to FRAMEWORK_OUTPUT_SIZE bytes are kept and only written when full, when
+// readLine waits for input and at exit, so a turn needs few or no writes.
+//
+// @param interactive  true if stdout is a terminal, see isatty
+//
+void initOutput(bool interactive);
+
+// ----------------------------------------------------------------------------
+// Reads lines from a file descriptor in blocks of up to FRAMEWORK_READER_SIZE
+// bytes into <buffer>, without allocating
+//
+// Every reader has its own state, so several can be used at the same time,
+// e.g. one per session. The lines are handed out in place.
+//
+typedef struct _LineReader_
+{
+  int fd;
+  size_t start;     // first byte in <buffer> that was not handed out
+  size_t end;       // end of the bytes read
+  bool ended;       // read returned end of file or an error
+  bool skipping;    // the rest of a line that was too long is skipped
+  char buffer[FRAMEWORK_READER_SIZE + 1];
+} LineReader;
+
+// ----------------------------------------------------------------------------
+// @param reader  the reader to set up
+// @param fd      the file descriptor to read, e.g. STDIN_FILENO
 //
-bool arePipesConnected(uint8_t** map, uint8_t width, uint8_t height, uint8_t start[2], uint8_t dest[2]);
+void initReader(LineReader* reader, int fd);
 
 // ----------------------------------------------------------------------------
-// reads a line (i.e., until newline is found) from stdin
+// Reads a line (i.e., until newline is found), stdout is flushed before
+// waiting for input
+//
+// The line stays valid and may be changed until the reader is used again.
+// A line longer than FRAMEWORK_READER_SIZE is cut, its rest is skipped.
+// A last line without newline is returned like any other.
+//
+// @param reader  the reader
+// @return        the null-terminated line, with newline stripped, NULL at
+//                the end of the input
 //
-// This function allocates memory to parse arbitrarily long strings, the return
-// value of this function must thus be `free`d when not needed anymore.
+char* readLine(LineReader* reader);
+
+// ----------------------------------------------------------------------------
+// Reads a word like scanf("%s"), i.e. whitespace (also newlines) before it is
+// skipped and it ends before the next whitespace
 //
-// Returns NULL, if out of memory
-// Returns EOF, if hits end of file
+// @param reader  the reader
+// @param word    set to the null-terminated word, the rest of a longer word
+//                is left for the next read
+// @param size    size of <word>
+// @return        false at the end of the input
 //
-// @return  the null-terminated line, with newline stripped
-char* getLine();
+bool readWord(LineReader* reader, char* word, size_t size);
 
 // ----------------------------------------------------------------------------
-// Parses the command and its arguments from the string <line>
+// Parses the command and its arguments from the string <line>, in place and
+// without allocating, so lines can be parsed in different threads at once
 //
 // Saves the parsed values to applicable parameters.
 // <cmd> is set to NONE when nothing or only whitespace is entered.
@@ -85,12 +222,15 @@ char* getLine();
 //  - <dir> is neither "left" or "right"
 //  - <row> or <col> are not an integer greater than 0
 //  - there are too few/many arguments
+// or if <cmd> is LEVEL and not followed by exactly one integer greater than 0
 //
 // @param line  the string to parse
 // @param cmd   the (well-known) command
 // @param dir   the direction, if <cmd> is ROTATE (see README.md#datentypen)
-// @param row   the row, if <cmd> is ROTATE
+// @param row   the row, if <cmd> is ROTATE, the level if <cmd> is LEVEL
 // @param col   the column, if <cmd> is ROTATE
 // @return      NULL on success; 1 on invalid arguments; command token on unknown command
 //
-char* parseCommand(char* line, Command* cmd, size_t* dir, uint8_t* row, uint8_t* col);
+char* parseCommand(char* line, Command* cmd, size_t* dir, uint32_t* row, uint32_t* col);
+
+#endif
@@ -0,0 +1,492 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "framework.h"
+#include "game.h"
+
+// ----------------------------------------------------------------------------
+uint8_t rotate_pipe_without_conflict(uint8_t value, uint8_t rotation)
+{
+  if (rotation == 3)
+  {
+    value = value>>2;
+    return value;
+  }
+  if (rotation == 1)
+  {
+    value = value<<2;
+    return value;
+  }
+  return value;
+}
+
+// ----------------------------------------------------------------------------
+uint8_t rotate_pipe_with_conflict(uint8_t value, uint8_t rotation)
+{
+  if (rotation == 3)
+  {
+    value = value>>2;
+    value += 128;
+    return value;
+  }
+  if (rotation == 1)
+  {
+    value = value<<2;
+    value += 2;
+    return value;
+  }
+  return value;
+}
+
+// ----------------------------------------------------------------------------
+bool could_conflict_occur(uint8_t value, uint8_t rotation)
+{
+  if (((value & 128 ) == 128) && rotation == 1)
+  {
+    //printf("\nConflict 0\n\n");
+    return true;
+  }
+  if (((value & 2 ) == 2) && rotation == 3)
+  {
+    //printf("\nConflict 1\n\n");
+    return true;
+  }
+  return false;
+  
+}
+
+// ----------------------------------------------------------------------------
+uint8_t remove_pipe_connections(uint8_t value)
+{
+  uint8_t value_without_connections = value;
+  if ((value & 1 ) == 1)
+  {
+    value_without_connections -= 1;
+  }
+  if ((value & 4 ) == 4)
+  {
+    value_without_connections -= 4;
+  }
+  if ((value & 16 ) == 16)
+  {
+    value_without_connections -= 16;
+  }
+  if ((value & 64 ) == 64)
+  {
+    value_without_connections -= 64;
+  }
+  return value_without_connections;
+}
+
+// ----------------------------------------------------------------------------
+void check_possible_connection(uint8_t* open_connections, uint8_t value)
+{
+  if ((value & 128 ) == 128)
+  {
+    open_connections[0] = 1;//top open
+  }else
+  {
+    open_connections[0] = 0;//top open
+  }
+  if ((value & 32 ) == 32)
+  {
+    open_connections[1] = 1;//left open 
+  }else
+  {
+    open_connections[1] = 0;//left open 
+  }
+  if ((value & 8 ) == 8)
+  {
+    open_connections[2] = 1;//bottom open
+  }else
+  {
+    open_connections[2] = 0;//bottom open
+  }
+  if ((value & 2 ) == 2)
+  {
+    open_connections[3] = 1;//right open
+  }else
+  {
+    open_connections[3] = 0;//right open
+  }
+}
+
+// ----------------------------------------------------------------------------
+void connect_pipes(uint8_t *map_data,uint8_t* courrent_field, uint8_t* above_field, uint8_t* behind_field, uint8_t* bellow_field, uint8_t* next_field)
+{
+  map_data[0] = remove_pipe_connections(map_data[0]);
+  if(courrent_field[0] == 1 && above_field[2] == 1)
+  {
+    map_data[0] += 64; 
+  }
+  if(courrent_field[1] == 1 && behind_field[3] == 1)
+  {
+    map_data[0] += 16; 
+  }
+  if(courrent_field[2] == 1 && bellow_field[0] == 1)
+  {
+    map_data[0] += 4; 
+  }
+  if(courrent_field[3] == 1 && next_field[1] == 1)
+  {
+    map_data[0] += 1; 
+  }
+}
+
+// ----------------------------------------------------------------------------
+void rebuild_every_connection_scalar(uint8_t* map_data, uint32_t height, uint32_t width)
+{
+  uint8_t courrent_field[4];
+  uint8_t above_field[4];
+  uint8_t behind_field[4];
+  uint8_t bellow_field[4];
+  uint8_t next_field[4];
+  for (uint32_t i = 1; i <= height; i++)
+  {
+    for (uint32_t j = 1; j <=  width; j++)
+    {
+      check_possible_connection(&courrent_field[0], map_data[0]);
+      check_possible_connection(&above_field[0], (i > 1) ? *(map_data - width) : 0);
+      check_possible_connection(&behind_field[0], (j > 1) ? map_data[0-1] : 0);
+      check_possible_connection(&next_field[0], (j < width) ? map_data[1] : 0);
+      check_possible_connection(&bellow_field[0], (i < height) ? map_data[width] : 0);
+      connect_pipes(&map_data[0], &courrent_field[0], &above_field[0], &behind_field[0], &bellow_field[0], &next_field[0]);
+      map_data++;
+    }
+  }
+}
+
+// the same bits in every byte of a word
+#define SWAR_BYTES(byte) ((uint64_t) (byte) * 0x0101010101010101u)
+#define SWAR_WIDTH 8u
+
+// ----------------------------------------------------------------------------
+// Loads up to 8 fields into a word, the first field goes into the lowest
+// byte. Missing fields are read as 0 (no openings).
+//
+static inline uint64_t load_fields(const uint8_t* fields, uint32_t count)
+{
+  uint64_t word = 0;
+  for (uint32_t i = 0; i < count; i++)
+  {
+    word |= (uint64_t) fields[i] << (8 * i);
+  }
+  return word;
+}
+
+// ----------------------------------------------------------------------------
+static inline void store_fields(uint8_t* fields, uint32_t count, uint64_t word)
+{
+  for (uint32_t i = 0; i < count; i++)
+  {
+    fields[i] = (uint8_t) (word >> (8 * i));
+  }
+}
+
+// ----------------------------------------------------------------------------
+// Computes the connection bits of 8 fields at once
+//
+// Every neighbour word holds the fields next to the ones in <fields> at the
+// same byte. Shifting a neighbour by 4 bits moves its opening towards the
+// current field onto the opening of the current field, shifting the match by
+// one more bit gives the connection bit. Only the opening bits of the
+// neighbours are used, so it does not matter if they were rebuilt already.
+//
+static inline uint64_t connect_fields(uint64_t fields, uint64_t above, uint64_t behind, uint64_t bellow, uint64_t next)
+{
+  uint64_t connected = fields & SWAR_BYTES(0xAA);
+  connected |= (fields & (above << 4) & SWAR_BYTES(128)) >> 1;
+  connected |= (fields & (behind << 4) & SWAR_BYTES(32)) >> 1;
+  connected |= (fields & (bellow >> 4) & SWAR_BYTES(8)) >> 1;
+  connected |= (fields & (next >> 4) & SWAR_BYTES(2)) >> 1;
+  return connected;
+}
+
+// ----------------------------------------------------------------------------
+void rebuild_every_connection(uint8_t* map_data, uint32_t height, uint32_t width)
+{
+  for (uint32_t row = 0; row < height; row++)
+  {
+    uint8_t* fields = &map_data[(size_t) row * width];
+    const uint8_t* above = (row > 0) ? fields - width : NULL;
+    const uint8_t* bellow = (row + 1 < height) ? fields + width : NULL;
+    uint8_t previous = 0;   // field left of the current word
+    for (uint32_t col = 0; col < width; col += SWAR_WIDTH)
+    {
+      uint32_t count = (width - col < SWAR_WIDTH) ? width - col : SWAR_WIDTH;
+      uint64_t current = load_fields(&fields[col], count);
+      uint64_t following = (col + count < width) ? fields[col + count] : 0;
+      uint64_t behind = (current << 8) | previous;
+      uint64_t next = (current >> 8) | (following << (8 * (count - 1)));
+      uint64_t up = (above != NULL) ? load_fields(&above[col], count) : 0;
+      uint64_t down = (bellow != NULL) ? load_fields(&bellow[col], count) : 0;
+      previous = fields[col + count - 1];
+      store_fields(&fields[col], count, connect_fields(current, up, behind, down, next));
+    }
+  }
+}
+
+// ----------------------------------------------------------------------------
+static uint8_t rebuild_field_connection(uint8_t* map_data, uint32_t height, uint32_t width, uint32_t row, uint32_t col)
+{
+  uint8_t* field = &map_data[(size_t) (row - 1) * width + (col - 1)];
+  uint8_t value = remove_pipe_connections(field[0]);
+  if ((value & 128) && row > 1 && (*(field - width) & 8))
+  {
+    value |= 64;
+  }
+  if ((value & 32) && col > 1 && (field[0-1] & 2))
+  {
+    value |= 16;
+  }
+  if ((value & 8) && row < height && (field[width] & 128))
+  {
+    value |= 4;
+  }
+  if ((value & 2) && col < width && (field[1] & 32))
+  {
+    value |= 1;
+  }
+  return value;
+}
+
+// ----------------------------------------------------------------------------
+void rebuild_connections_around(uint8_t* map_data, uint32_t height, uint32_t width, uint32_t row, uint32_t col)
+{
+  uint8_t* field = &map_data[(size_t) (row - 1) * width + (col - 1)];
+  field[0] = rebuild_field_connection(map_data, height, width, row, col);
+  if (row > 1)
+  {
+    *(field - width) = rebuild_field_connection(map_data, height, width, row - 1, col);
+  }
+  if (col > 1)
+  {
+    field[0-1] = rebuild_field_connection(map_data, height, width, row, col - 1);
+  }
+  if (row < height)
+  {
+    field[width] = rebuild_field_connection(map_data, height, width, row + 1, col);
+  }
+  if (col < width)
+  {
+    field[1] = rebuild_field_connection(map_data, height, width, row, col + 1);
+  }
+}
+
+// ----------------------------------------------------------------------------
+void verify_every_connection(uint8_t* map_data, uint32_t height, uint32_t width)
+{
+  size_t fields = (size_t) height * width;
+  uint8_t* reference = (uint8_t*) malloc(fields);
+  if (reference == NULL)
+  {
+    return;
+  }
+  memcpy(reference, map_data, fields);
+  rebuild_every_connection_scalar(reference, height, width);
+  for (size_t i = 0; i < fields; i++)
+  {
+    if (reference[i] != map_data[i])
+    {
+      fprintf(stderr, "Connection mismatch at %zu %zu: %02x instead of %02x\n",
+        i / width + 1, i % width + 1, map_data[i], reference[i]);
+      abort();
+    }
+  }
+  free(reference);
+}
+
+// ----------------------------------------------------------------------------
+bool game_init(Game* game, const Level* level)
+{
+  game->start[0] = level->start[0];
+  game->start[1] = level->start[1];
+  game->dest[0] = level->dest[0];
+  game->dest[1] = level->dest[1];
+  game->connections_valid = false;
+  game->turn = 1;
+  game->journal = NULL;
+  game->journal_size = 0;
+  game->journal_capacity = 0;
+  game->undone = 0;
+  if (!grid_init(&game->grid, level->width, level->height))
+  {
+    return false;
+  }
+  size_t fields = grid_size(&game->grid);
+  game->pristine = (uint8_t*) malloc(fields);
+  if (game->pristine == NULL)
+  {
+    grid_free(&game->grid);
+    return false;
+  }
+  memcpy(game->pristine, level->fields, fields);
+  rebuild_every_connection(game->pristine, level->height, level->width);
+  // a version 2 file only stores the openings, so the first turn starts
+  // with the rebuilt connections
+  memcpy(game->grid.fields, (level->version == 2) ? game->pristine : level->fields, fields);
+  if (!reachability_init(&game->reach, game->grid.rows, level->width, level->height, game->start, game->dest))
+  {
+    grid_free(&game->grid);
+    free(game->pristine);
+    return false;
+  }
+  return true;
+}
+
+// ----------------------------------------------------------------------------
+void game_free(Game* game)
+{
+  grid_free(&game->grid);
+  reachability_free(&game->reach);
+  free(game->pristine);
+  free(game->journal);
+  game->pristine = NULL;
+  game->journal = NULL;
+}
+
+// ----------------------------------------------------------------------------
+uint8_t rotate_pipe(uint8_t value, size_t direction)
+{
+  uint8_t rotation = (direction == 3) ? 1 : 3;   //flipping the directions
+  if (value == 0 || value == 255)
+  {
+    return value;
+  }
+  uint8_t value_after_rotation = remove_pipe_connections(value);
+  (could_conflict_occur(value_after_rotation, rotation)) ? (value_after_rotation = rotate_pipe_with_conflict(value_after_rotation, rotation)) :
+    (value_after_rotation = rotate_pipe_without_conflict(value_after_rotation, rotation));
+  return value_after_rotation;
+}
+
+// ----------------------------------------------------------------------------
+static void rotate_field(Game* game, uint32_t row, uint32_t col, size_t direction)
+{
+  Grid* grid = &game->grid;
+  uint8_t value_of_sector = grid_get(grid, row, col);
+  if (value_of_sector > 0 && value_of_sector < 255)
+  {
+    grid_set(grid, row, col, rotate_pipe(value_of_sector, direction));
+    if (game->connections_valid)
+    {
+      rebuild_connections_around(grid->fields, grid->height, grid->width, row + 1, col + 1);
+      reachability_update(&game->reach, grid->rows, row, col);
+    }
+  }
+}
+
+// ----------------------------------------------------------------------------
+bool game_rotate(Game* game, uint32_t row, uint32_t col, size_t direction)
+{
+  // whatever was undone is replaced by this rotation
+  game->journal_size -= game->undone;
+  game->undone = 0;
+  if (game->journal_size == game->journal_capacity)
+  {
+    size_t capacity = (game->journal_capacity == 0) ? 64 : game->journal_capacity * 2;
+    Move* journal = (Move*) realloc(game->journal, capacity * sizeof(Move));
+    if (journal == NULL)
+    {
+      return false;
+    }
+    game->journal = journal;
+    game->journal_capacity = capacity;
+  }
+  game->journal[game->journal_size].field = row * game->grid.width + col;
+  game->journal[game->journal_size].direction = (uint8_t) direction;
+  game->journal_size++;
+  rotate_field(game, row, col, direction);
+  return true;
+}
+
+// ----------------------------------------------------------------------------
+bool game_undo(Game* game)
+{
+  if (!game_can_undo(game))
+  {
+    return false;
+  }
+  game->undone++;
+  Move* move = &game->journal[game->journal_size - game->undone];
+  uint32_t width = game->grid.width;
+  rotate_field(game, move->field / width, move->field % width, (move->direction == 3) ? 1 : 3);
+  return true;
+}
+
+// ----------------------------------------------------------------------------
+bool game_redo(Game* game)
+{
+  if (!game_can_redo(game))
+  {
+    return false;
+  }
+  Move* move = &game->journal[game->journal_size - game->undone];
+  uint32_t width = game->grid.width;
+  rotate_field(game, move->field / width, move->field % width, move->direction);
+  game->undone--;
+  return true;
+}
+
+// ----------------------------------------------------------------------------
+bool game_apply(Game* game, Command cmmd, size_t direction, uint32_t row, uint32_t col)
+{
+  switch (cmmd)
+  {
+    case RESTART:
+      game_restart(game);
+      return true;
+    case ROTATE:
+      return game_rotate(game, row - 1, col - 1, direction);
+    case UNDO:
+      game_undo(game);
+      return true;
+    case REDO:
+      game_redo(game);
+      return true;
+    default:
+      return true;
+  }
+}
+
+// ----------------------------------------------------------------------------
+void game_restart(Game* game)
+{
+  Grid* grid = &game->grid;
+  memcpy(grid->fields, game->pristine, grid_size(grid));
+  reachability_reset(&game->reach, grid->rows);
+  game->connections_valid = true;
+  game->journal_size = 0;
+  game->undone = 0;
+  game->turn = 0;
+}
+
+// ----------------------------------------------------------------------------
+void game_end_turn(Game* game)
+{
+  Grid* grid = &game->grid;
+  game->turn++;
+  if (!game->connections_valid)   // map was loaded from file
+  {
+    rebuild_every_connection(grid->fields, grid->height, grid->width);
+    reachability_reset(&game->reach, grid->rows);
+    game->connections_valid = true;
+  }
+#ifdef A3_VERIFY_CONNECTIONS
+  verify_every_connection(grid->fields, grid->height, grid->width);
+#endif
+}
+
+// ----------------------------------------------------------------------------
+bool game_is_solved(const Game* game)
+{
+  bool is_finished = reachability_is_connected(&game->reach);
+#ifdef A3_VERIFY_CONNECTIONS
+  if (is_finished != arePipesConnected(game->grid.rows, game->grid.width, game->grid.height, (uint32_t*) game->start, (uint32_t*) game->dest))
+  {
+    fprintf(stderr, "Reachability mismatch: %d instead of %d\n", is_finished, !is_finished);
+    abort();
+  }
+#endif
+  return is_finished;
+}
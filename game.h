@@ -0,0 +1,274 @@
+#ifndef GAME_H
+#define GAME_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "connectivity.h"
+#include "framework.h"
+#include "grid.h"
+#include "level.h"
+
+// ----------------------------------------------------------------------------
+// One rotation in the journal of a game
+//
+typedef struct _Move_
+{
+  uint32_t field;       // row * width + column
+  uint8_t direction;    // 1 for left, 3 for right (see parseCommand)
+} Move;
+
+// ----------------------------------------------------------------------------
+// State of one running game
+//
+// <turn> is the number shown in the prompt, the score of a solved game is
+// <turn> - 1. The connections of the fields are rebuilt lazily: after the map
+// was loaded they are taken from the file until the end of the first turn.
+//
+// <pristine> is the loaded map with rebuilt connections, restart copies it
+// back without touching the file. <journal> holds every rotation since the
+// last restart, the first <undone> of them from the end were undone and can
+// be redone.
+//
+typedef struct _Game_
+{
+  Grid grid;
+  uint32_t start[2];
+  uint32_t dest[2];
+  Reachability reach;
+  uint8_t* pristine;
+  bool connections_valid;
+  int turn;
+  Move* journal;
+  size_t journal_size;
+  size_t journal_capacity;
+  size_t undone;
+} Game;
+
+// ----------------------------------------------------------------------------
+// Rotates the pipe depending on the rotation direction
+//
+// @param value                   value of the pipe before rotation
+// @param rotation                what direction is the pipe turning
+//
+// @return                        returns the data of the pipe after rotation
+//
+uint8_t rotate_pipe_without_conflict(uint8_t value, uint8_t rotation);
+
+// ----------------------------------------------------------------------------
+// Rotates the pipe depending on the rotation direction
+//
+// @param value                   value of the pipe before rotation
+// @param rotation                what direction is the pipe turning
+//
+// @return                        returns the data of the pipe after rotation
+//
+uint8_t rotate_pipe_with_conflict(uint8_t value, uint8_t rotation);
+
+// ----------------------------------------------------------------------------
+// Rotates a pipe like the rotate command does, walls (0) and 255 stay as
+// they are
+//
+// @param value                   value of the pipe before rotation
+// @param direction               1 for left, 3 for right (see parseCommand)
+//
+// @return                        the pipe after rotation, without connections
+//
+uint8_t rotate_pipe(uint8_t value, size_t direction);
+
+// ----------------------------------------------------------------------------
+// Determens if there would be lost data if bitshifting is used
+//
+// @param value     value of the pipe before rotation
+// @param rotation   what direction is the pipe turning
+//
+bool could_conflict_occur(uint8_t value, uint8_t rotation);
+
+// ----------------------------------------------------------------------------
+// Removes all connections on the pipe
+//
+// @param value                   value of pipe
+//
+// @return                        returns the pipe without connections
+//
+uint8_t remove_pipe_connections(uint8_t value);
+
+// ----------------------------------------------------------------------------
+// Checks if there is a possible connections inbetween two pipes
+//
+// @param open_connections        is the connection even possible
+// @param value                   data of the pipe that is being analised
+//
+void check_possible_connection(uint8_t* open_connections, uint8_t value);
+
+// ----------------------------------------------------------------------------
+// Connects the pipes that are given
+//
+// @param map_data                variable that contains the map data
+// @param courrent_field          location of the currently selected pipe
+// @param above_field             pipe above the currently selected one
+// @param behind_field            pipe behind the currently selected one
+// @param bellow_field            pipe below the currently selected one
+// @param next_field              pipe after the currently selected one
+//
+void connect_pipes(uint8_t *map_data,uint8_t* courrent_field, uint8_t* above_field, uint8_t* behind_field, uint8_t* bellow_field, uint8_t* next_field);
+
+// ----------------------------------------------------------------------------
+// Goes trough the whole map and rebuilds the connections inbetween pipes
+//
+// Fields outside of the map are treated as walls. This is the reference
+// implementation that rebuild_every_connection and rebuild_connections_around
+// are verified against.
+//
+// @param map_data                variable that contains the map data
+// @param height                  the height of the map
+// @param width                   the width of the map
+//
+void rebuild_every_connection_scalar(uint8_t* map_data, uint32_t height, uint32_t width);
+
+// ----------------------------------------------------------------------------
+// Rebuilds the connections of the whole map, 8 fields at a time
+//
+// Produces the same bits as rebuild_every_connection_scalar.
+//
+// @param map_data                variable that contains the map data
+// @param height                  the height of the map
+// @param width                   the width of the map
+//
+void rebuild_every_connection(uint8_t* map_data, uint32_t height, uint32_t width);
+
+// ----------------------------------------------------------------------------
+// Rebuilds the connections of a rotated pipe and its four neighbours
+//
+// A rotation can only change the connections of these five fields, so this
+// produces the same bits as rebuild_every_connection as long as the rest of
+// the map was up to date before the rotation.
+//
+// @param map_data                variable that contains the map data
+// @param height                  the height of the map
+// @param width                   the width of the map
+// @param row                     row of the rotated pipe (starting at 1)
+// @param col                     collumn of the rotated pipe (starting at 1)
+//
+void rebuild_connections_around(uint8_t* map_data, uint32_t height, uint32_t width, uint32_t row, uint32_t col);
+
+// ----------------------------------------------------------------------------
+// Checks the incrementally updated connections against a full rebuild
+//
+// Only used when compiled with A3_VERIFY_CONNECTIONS. Aborts on the first
+// field whose connections differ from rebuild_every_connection.
+//
+// @param map_data                variable that contains the map data
+// @param height                  the height of the map
+// @param width                   the width of the map
+//
+void verify_every_connection(uint8_t* map_data, uint32_t height, uint32_t width);
+
+// ----------------------------------------------------------------------------
+// Starts a game on the map of a level
+//
+// The map is copied, the level can be closed afterwards.
+//
+// @param game                    the game to initialise
+// @param level                   the loaded config file
+//
+// @return                        false if out of memory, otherwise true
+//
+bool game_init(Game* game, const Level* level);
+
+// ----------------------------------------------------------------------------
+// Frees the memory of a game
+//
+// @param game                    the game
+//
+void game_free(Game* game);
+
+// ----------------------------------------------------------------------------
+// Rotates a pipe and adds it to the journal, start- and dest-pipe have to be
+// checked by the caller
+//
+// Rotations that were undone before can not be redone anymore afterwards.
+//
+// @param game                    the game
+// @param row                     row of the pipe (starting at 0)
+// @param col                     collumn of the pipe (starting at 0)
+// @param direction               1 for left, 3 for right (see parseCommand)
+//
+// @return                        false if out of memory, nothing is rotated then
+//
+bool game_rotate(Game* game, uint32_t row, uint32_t col, size_t direction);
+
+// ----------------------------------------------------------------------------
+// Rotates the pipe of the last rotation back
+//
+// @param game                    the game
+//
+// @return                        false if there is nothing to undo
+//
+bool game_undo(Game* game);
+
+// ----------------------------------------------------------------------------
+// Rotates the pipe of the last undone rotation again
+//
+// @param game                    the game
+//
+// @return                        false if there is nothing to redo
+//
+bool game_redo(Game* game);
+
+// ----------------------------------------------------------------------------
+// @return                        true if there is a rotation to undo
+//
+static inline bool game_can_undo(const Game* game)
+{
+  return game->undone < game->journal_size;
+}
+
+// ----------------------------------------------------------------------------
+// @return                        true if there is an undone rotation to redo
+//
+static inline bool game_can_redo(const Game* game)
+{
+  return game->undone > 0;
+}
+
+// ----------------------------------------------------------------------------
+// Executes a checked command that changes the map, other commands are ignored
+//
+// Does not end the turn, see game_end_turn.
+//
+// @param game                    the game
+// @param cmmd                    RESTART, ROTATE, UNDO or REDO
+// @param direction               1 for left, 3 for right (see parseCommand)
+// @param row                     row of the pipe to rotate (starting at 1)
+// @param col                     collumn of the pipe to rotate (starting at 1)
+//
+// @return                        false if out of memory
+//
+bool game_apply(Game* game, Command cmmd, size_t direction, uint32_t row, uint32_t col);
+
+// ----------------------------------------------------------------------------
+// Resets the map to the one from the config file and clears the journal
+//
+// @param game                    the game
+//
+void game_restart(Game* game);
+
+// ----------------------------------------------------------------------------
+// Finishes a turn, every accepted command ends one
+//
+// @param game                    the game
+//
+void game_end_turn(Game* game);
+
+// ----------------------------------------------------------------------------
+// Checks if start- and dest-pipe are connected
+//
+// @param game                    the game
+//
+// @return                        true if the puzzle is solved
+//
+bool game_is_solved(const Game* game);
+
+#endif
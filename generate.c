@@ -0,0 +1,289 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "framework.h"
+#include "game.h"
+#include "grid.h"
+#include "highscore.h"
+#include "level.h"
+
+#define USAGE_GENERATOR "Usage: ./generate WIDTH HEIGHT DENSITY SEED CONFIG_FILE [VERSION]\n"
+#define INFO_GENERATED  "Generated %ux%u map, path of %zu fields: %s\n"
+
+// placeholder highscores, free places for the first players (see HIGHSCORE_FREE)
+#define GENERATOR_SUBMISSIONS 3
+#define GENERATOR_SCORE       127
+
+// a solved map after scrambling is rare, this only guards tiny maps
+#define GENERATOR_SCRAMBLE_TRIES 64
+
+// neighbours in the order up, left, down, right (see README.md#datentypen)
+#define OPENING(dir)  ((uint8_t) (0x80u >> (2 * (dir))))
+#define OPPOSITE(dir) (((dir) + 2) % 4)
+
+// ----------------------------------------------------------------------------
+// State of the random number generator (splitmix64), so the same seed gives
+// the same map on every platform
+//
+static uint64_t random_state;
+
+// ----------------------------------------------------------------------------
+static uint64_t next_random(void)
+{
+  uint64_t value = (random_state += 0x9E3779B97F4A7C15u);
+  value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9u;
+  value = (value ^ (value >> 27)) * 0x94D049BB133111EBu;
+  return value ^ (value >> 31);
+}
+
+// ----------------------------------------------------------------------------
+// @return  a random number from 0 to <bound> - 1
+//
+static uint32_t random_below(uint32_t bound)
+{
+  return (uint32_t) ((next_random() >> 32) * bound >> 32);
+}
+
+// ----------------------------------------------------------------------------
+// Rotates the openings of a pipe by a quarter turn, see rotate_pipe_with_conflict
+//
+static uint8_t rotate_quarter(uint8_t value)
+{
+  return (uint8_t) ((value << 2) | (value >> 6));
+}
+
+// ----------------------------------------------------------------------------
+// Parses a decimal number up to <max>
+//
+// @return  false if <text> is not a number or too big
+//
+static bool parse_number(const char* text, uint32_t max, uint32_t* number)
+{
+  char* end = NULL;
+  unsigned long long value = strtoull(text, &end, 10);
+  if (*text < '0' || *text > '9' || *end != '\0' || value > max)
+  {
+    return false;
+  }
+  *number = (uint32_t) value;
+  return true;
+}
+
+// ----------------------------------------------------------------------------
+// Lays a random path from start to dest into <fields>
+//
+// Runs a randomised depth first search from the start pipe until it reaches
+// the dest pipe and then follows the search tree back to the start. The
+// path never crosses itself, so every field on it gets exactly the two
+// openings towards its neighbours on the path.
+//
+// @return  length of the path in fields, 0 if out of memory
+//
+static size_t lay_path(uint8_t* fields, uint8_t* on_path, uint32_t width, uint32_t height,
+  const uint32_t start[2], const uint32_t dest[2])
+{
+  size_t size = (size_t) width * height;
+  uint8_t* from = (uint8_t*) malloc(size);   // direction to the parent, 4 if not visited
+  uint32_t* stack = (uint32_t*) malloc(size * sizeof(uint32_t));
+  if (from == NULL || stack == NULL)
+  {
+    free(from);
+    free(stack);
+    return 0;
+  }
+  memset(from, 4, size);
+
+  uint32_t first = start[0] * width + start[1];
+  uint32_t target = dest[0] * width + dest[1];
+  size_t top = 0;
+  stack[top++] = first;
+  from[first] = 0;
+  while (top > 0 && from[target] == 4)
+  {
+    uint32_t index = stack[top - 1];
+    uint32_t row = index / width;
+    uint32_t col = index % width;
+    uint32_t next[4];
+    uint8_t dirs[4];
+    uint8_t count = 0;
+    uint32_t neighbour[4] = { index - width, index - 1, index + width, index + 1 };
+    bool inside[4] = { row > 0, col > 0, row < height - 1, col < width - 1 };
+    for (uint8_t dir = 0; dir < 4; dir++)
+    {
+      if (inside[dir] && from[neighbour[dir]] == 4)
+      {
+        next[count] = neighbour[dir];
+        dirs[count++] = dir;
+      }
+    }
+    if (count == 0)
+    {
+      top--;
+      continue;
+    }
+    uint8_t pick = (uint8_t) random_below(count);
+    from[next[pick]] = (uint8_t) OPPOSITE(dirs[pick]);
+    stack[top++] = next[pick];
+  }
+
+  // the stack holds the path from start to dest
+  for (size_t i = 0; i < top; i++)
+  {
+    uint32_t index = stack[i];
+    uint8_t value = 0;
+    if (i > 0)
+    {
+      value |= OPENING(from[index]);
+    }
+    if (i + 1 < top)
+    {
+      value |= OPENING(OPPOSITE(from[stack[i + 1]]));
+    }
+    fields[index] = value;
+    on_path[index] = 1;
+  }
+  free(from);
+  free(stack);
+  return top;
+}
+
+// ----------------------------------------------------------------------------
+// The combinations of openings of the pipes off the path, one bit per
+// direction: the two-, three- and four-way pipes
+//
+static const uint8_t PIPE_SHAPES[] = { 0x3, 0x5, 0x6, 0x9, 0xA, 0xC, 0x7, 0xB, 0xD, 0xE, 0xF };
+
+// ----------------------------------------------------------------------------
+// Fills the fields next to the path and rotates every pipe randomly
+//
+// @param density   chance in percent that a field off the path gets a pipe
+//
+static void fill_and_scramble(uint8_t* fields, const uint8_t* on_path, size_t size, uint32_t density,
+  uint32_t first, uint32_t target)
+{
+  for (size_t index = 0; index < size; index++)
+  {
+    if (!on_path[index] && random_below(100) < density)
+    {
+      // a pipe with a single opening only exists as start- or dest-pipe
+      uint32_t openings = PIPE_SHAPES[random_below(sizeof(PIPE_SHAPES) / sizeof(PIPE_SHAPES[0]))];
+      for (uint8_t dir = 0; dir < 4; dir++)
+      {
+        if (openings & (1u << dir))
+        {
+          fields[index] |= OPENING(dir);
+        }
+      }
+    }
+    // start- and dest-pipe can not be rotated in the game
+    if (index != first && index != target)
+    {
+      for (uint32_t turns = random_below(4); turns > 0; turns--)
+      {
+        fields[index] = rotate_quarter(fields[index]);
+      }
+    }
+  }
+}
+
+int main(int argc, char const **argv)
+{
+  uint32_t width;
+  uint32_t height;
+  uint32_t density;
+  uint32_t seed;
+  uint32_t version = 0;
+  if (argc < 6 || argc > 7 || !parse_number(argv[1], UINT32_MAX, &width) || !parse_number(argv[2], UINT32_MAX, &height)
+    || !parse_number(argv[3], 100, &density) || !parse_number(argv[4], UINT32_MAX, &seed)
+    || (argc == 7 && !parse_number(argv[6], 2, &version))
+    || width == 0 || height == 0 || (uint64_t) width * height < 2 || (uint64_t) width * height > UINT32_MAX
+    || (argc == 7 && version == 0 && (width > UINT8_MAX || height > UINT8_MAX)))
+  {
+    printf("%s", USAGE_GENERATOR);
+    return 1;
+  }
+  random_state = seed;
+
+  size_t size = (size_t) width * height;
+  Grid grid;
+  if (!grid_init(&grid, width, height))
+  {
+    printf("%s", ERROR_OUT_OF_MEMORY);
+    return 4;
+  }
+  uint8_t* fields = grid.fields;
+  uint8_t* on_path = (uint8_t*) calloc(size, 1);
+  if (on_path == NULL)
+  {
+    printf("%s", ERROR_OUT_OF_MEMORY);
+    grid_free(&grid);
+    return 4;
+  }
+
+  uint32_t start[2] = { random_below(height), random_below(width) };
+  uint32_t dest[2];
+  do
+  {
+    dest[0] = random_below(height);
+    dest[1] = random_below(width);
+  } while (dest[0] == start[0] && dest[1] == start[1]);
+  uint32_t first = start[0] * width + start[1];
+  uint32_t target = dest[0] * width + dest[1];
+
+  size_t length = lay_path(fields, on_path, width, height, start, dest);
+  if (length == 0)
+  {
+    printf("%s", ERROR_OUT_OF_MEMORY);
+    grid_free(&grid);
+    free(on_path);
+    return 4;
+  }
+  fill_and_scramble(fields, on_path, size, density, first, target);
+
+  // the connections of the first turn are taken from the file
+  rebuild_every_connection(fields, height, width);
+
+  // make sure the player has something to do
+  for (int tries = 0; tries < GENERATOR_SCRAMBLE_TRIES && arePipesConnected(grid.rows, width, height, start, dest); tries++)
+  {
+    uint32_t index = random_below((uint32_t) size);
+    if (on_path[index] && index != first && index != target)
+    {
+      fields[index] = rotate_quarter(fields[index]);
+      rebuild_connections_around(fields, height, width, index / width + 1, index % width + 1);
+    }
+  }
+  free(on_path);
+
+  uint8_t highscores[GENERATOR_SUBMISSIONS * 4];
+  for (int i = 0; i < GENERATOR_SUBMISSIONS; i++)
+  {
+    highscores[i * 4] = GENERATOR_SCORE;
+    memcpy(&highscores[i * 4 + 1], HIGHSCORE_FREE, HIGHSCORE_NAME_SIZE);
+  }
+
+  Level level;
+  if (argc == 6)   // the smallest version that fits the map
+  {
+    version = (width <= UINT8_MAX && height <= UINT8_MAX) ? 0 : 1;
+  }
+  level.version = (uint8_t) version;
+  level.width = width;
+  level.height = height;
+  level.start[0] = start[0];
+  level.start[1] = start[1];
+  level.dest[0] = dest[0];
+  level.dest[1] = dest[1];
+  level.submissions = GENERATOR_SUBMISSIONS;
+  level.highscores = highscores;
+  level.fields = fields;
+  LevelError error = level_save(&level, argv[5]);
+  grid_free(&grid);
+  if (error != LEVEL_OK)
+  {
+    printf(ERROR_OPEN_FILE, argv[5]);
+    return 2;
+  }
+  printf(INFO_GENERATED, width, height, length, argv[5]);
+  return 0;
+}
@@ -0,0 +1,31 @@
+#include <stdlib.h>
+
+#include "grid.h"
+
+// ----------------------------------------------------------------------------
+bool grid_init(Grid* grid, uint32_t width, uint32_t height)
+{
+  grid->width = width;
+  grid->height = height;
+  grid->fields = (uint8_t*) calloc(grid_size(grid), sizeof(uint8_t));
+  grid->rows = (uint8_t**) malloc(height * sizeof(uint8_t*));
+  if (grid->fields == NULL || grid->rows == NULL)
+  {
+    grid_free(grid);
+    return false;
+  }
+  for (uint32_t row = 0; row < height; ++row)
+  {
+    grid->rows[row] = &grid->fields[(size_t) row * width];
+  }
+  return true;
+}
+
+// ----------------------------------------------------------------------------
+void grid_free(Grid* grid)
+{
+  free(grid->fields);
+  free(grid->rows);
+  grid->fields = NULL;
+  grid->rows = NULL;
+}
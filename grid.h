@@ -0,0 +1,67 @@
+#ifndef GRID_H
+#define GRID_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// ----------------------------------------------------------------------------
+// The game map
+//
+// <fields> holds one byte per field, row by row. <rows> points to the start
+// of every row in <fields> and is built once, so it can be handed to
+// printMap and arePipesConnected directly.
+//
+// get and set do no bounds checking, rows and columns (starting at 0) have to
+// be checked where they enter the game, e.g. in is_input_valid.
+//
+typedef struct _Grid_
+{
+  uint32_t width;
+  uint32_t height;
+  uint8_t* fields;
+  uint8_t** rows;
+} Grid;
+
+// ----------------------------------------------------------------------------
+// Allocates an empty map
+//
+// @param grid    the map to initialise
+// @param width   the maps width
+// @param height  the maps height
+// @return        false if out of memory, otherwise true
+//
+bool grid_init(Grid* grid, uint32_t width, uint32_t height);
+
+// ----------------------------------------------------------------------------
+// Frees the memory of the map
+//
+// @param grid    the map
+//
+void grid_free(Grid* grid);
+
+// ----------------------------------------------------------------------------
+// @return  the number of fields of the map
+//
+static inline size_t grid_size(const Grid* grid)
+{
+  return (size_t) grid->width * grid->height;
+}
+
+// ----------------------------------------------------------------------------
+// @return  the value of the field in <row> and <col>
+//
+static inline uint8_t grid_get(const Grid* grid, uint32_t row, uint32_t col)
+{
+  return grid->fields[(size_t) row * grid->width + col];
+}
+
+// ----------------------------------------------------------------------------
+// Sets the value of the field in <row> and <col>
+//
+static inline void grid_set(Grid* grid, uint32_t row, uint32_t col, uint8_t value)
+{
+  grid->fields[(size_t) row * grid->width + col] = value;
+}
+
+#endif
@@ -0,0 +1,439 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "highscore.h"
+
+#define LOG_MAGIC       "ESScores"
+#define LOG_MAGIC_SIZE  8
+#define RECORD_SIZE     8
+#define RECORD_CHECK    0x5A
+
+// records read from the log at once
+#define READ_RECORDS 512
+
+// ----------------------------------------------------------------------------
+static void encode_record(const HighscoreEntry* entry, uint8_t* record)
+{
+  uint8_t check = RECORD_CHECK;
+  for (int i = 0; i < 4; i++)
+  {
+    record[i] = (uint8_t) (entry->score >> (8 * i));
+  }
+  memcpy(record + 4, entry->name, HIGHSCORE_NAME_SIZE);
+  for (int i = 0; i < RECORD_SIZE - 1; i++)
+  {
+    check = (uint8_t) (check + record[i]);
+  }
+  record[RECORD_SIZE - 1] = check;
+}
+
+// ----------------------------------------------------------------------------
+// @return  false if the check byte does not match, the record was damaged
+//
+static bool decode_record(const uint8_t* record, HighscoreEntry* entry)
+{
+  uint8_t check = RECORD_CHECK;
+  for (int i = 0; i < RECORD_SIZE - 1; i++)
+  {
+    check = (uint8_t) (check + record[i]);
+  }
+  entry->score = (uint32_t) record[0] | (uint32_t) record[1] << 8 | (uint32_t) record[2] << 16
+    | (uint32_t) record[3] << 24;
+  memcpy(entry->name, record + 4, HIGHSCORE_NAME_SIZE);
+  return check == record[RECORD_SIZE - 1];
+}
+
+// ----------------------------------------------------------------------------
+// Puts a score in front of the first entry with a higher score, like the
+// table of the config file was always updated
+//
+// @return  false if the score does not make it into the table
+//
+static bool insert_entry(Highscores* highscores, const HighscoreEntry* entry)
+{
+  size_t position = 0;
+  while (position < highscores->count && highscores->entries[position].score <= entry->score)
+  {
+    position++;
+  }
+  if (position >= highscores->capacity)
+  {
+    return false;
+  }
+  size_t count = (highscores->count < highscores->capacity) ? highscores->count + 1 : highscores->capacity;
+  memmove(&highscores->entries[position + 1], &highscores->entries[position],
+    (count - position - 1) * sizeof(HighscoreEntry));
+  highscores->entries[position] = *entry;
+  highscores->count = count;
+  return true;
+}
+
+// ----------------------------------------------------------------------------
+static void use_initial(Highscores* highscores)
+{
+  memcpy(highscores->entries, highscores->initial, highscores->initial_count * sizeof(HighscoreEntry));
+  highscores->count = highscores->initial_count;
+}
+
+// ----------------------------------------------------------------------------
+// Writes all of <data> unless an error occurs
+//
+static bool write_all(int fd, const uint8_t* data, size_t size)
+{
+  while (size > 0)
+  {
+    ssize_t written = write(fd, data, size);
+    if (written <= 0)
+    {
+      return false;
+    }
+    data += written;
+    size -= (size_t) written;
+  }
+  return true;
+}
+
+// ----------------------------------------------------------------------------
+// Makes the rename of a file in the directory of <path> durable
+//
+static void sync_directory(const char* path)
+{
+  const char* slash = strrchr(path, '/');
+  char* directory = (slash == NULL) ? NULL : strndup(path, (size_t) (slash - path + 1));
+  int fd = open((slash == NULL) ? "." : directory, O_RDONLY);
+  if (fd >= 0)
+  {
+    fsync(fd);
+    close(fd);
+  }
+  free(directory);
+}
+
+// ----------------------------------------------------------------------------
+// Opens the log after it was created or replaced, the table is what it holds
+//
+static void reopen_log(Highscores* highscores)
+{
+  struct stat info;
+  if (highscores->log_fd >= 0)
+  {
+    close(highscores->log_fd);
+  }
+  highscores->log_fd = open(highscores->path, O_RDWR | O_APPEND);
+  highscores->damaged = highscores->log_fd < 0 || fstat(highscores->log_fd, &info) != 0;
+  if (!highscores->damaged)
+  {
+    highscores->device = info.st_dev;
+    highscores->inode = info.st_ino;
+  }
+}
+
+// ----------------------------------------------------------------------------
+// Replaces the log by one with just the records of the table
+//
+// @return  false if the log could not be written, it is unchanged then
+//
+static bool compact_log(Highscores* highscores)
+{
+  size_t size = LOG_MAGIC_SIZE + highscores->count * RECORD_SIZE;
+  uint8_t* data = (uint8_t*) malloc(size);
+  if (data == NULL)
+  {
+    return false;
+  }
+  memcpy(data, LOG_MAGIC, LOG_MAGIC_SIZE);
+  for (size_t i = 0; i < highscores->count; i++)
+  {
+    encode_record(&highscores->entries[i], data + LOG_MAGIC_SIZE + i * RECORD_SIZE);
+  }
+  int fd = open(highscores->temporary_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  bool written = fd >= 0 && write_all(fd, data, size) && fsync(fd) == 0;
+  free(data);
+  if (fd >= 0)
+  {
+    written = close(fd) == 0 && written;
+  }
+  if (!written || rename(highscores->temporary_path, highscores->path) != 0)
+  {
+    unlink(highscores->temporary_path);
+    return false;
+  }
+  sync_directory(highscores->path);
+  reopen_log(highscores);
+  highscores->offset = (off_t) size;
+  highscores->records = highscores->count;
+  return true;
+}
+
+// ----------------------------------------------------------------------------
+// Reads the records that were appended since the last call
+//
+static void read_records(Highscores* highscores)
+{
+  uint8_t buffer[READ_RECORDS * RECORD_SIZE];
+  while (!highscores->damaged)
+  {
+    ssize_t got = pread(highscores->log_fd, buffer, sizeof(buffer), highscores->offset);
+    if (got <= 0)
+    {
+      // a failed read is no reason to drop what was read so far
+      highscores->damaged = got < 0;
+      return;
+    }
+    for (ssize_t i = 0; i + RECORD_SIZE <= got && !highscores->damaged; i += RECORD_SIZE)
+    {
+      HighscoreEntry entry;
+      highscores->damaged = !decode_record(buffer + i, &entry);
+      if (!highscores->damaged)
+      {
+        insert_entry(highscores, &entry);
+        highscores->records++;
+        highscores->offset += RECORD_SIZE;
+      }
+    }
+    // a record cut off by a crash, appends are done under the lock
+    highscores->damaged = highscores->damaged || got % RECORD_SIZE != 0;
+  }
+}
+
+// ----------------------------------------------------------------------------
+// Brings the table up to date with the log, which may have been appended to
+// or compacted by another process
+//
+static void sync_log(Highscores* highscores)
+{
+  struct stat info;
+  if (stat(highscores->path, &info) != 0)
+  {
+    if (highscores->log_fd >= 0)
+    {
+      close(highscores->log_fd);
+      highscores->log_fd = -1;
+    }
+    use_initial(highscores);
+    highscores->damaged = false;
+    return;
+  }
+  if (highscores->log_fd < 0 || info.st_dev != highscores->device || info.st_ino != highscores->inode)
+  {
+    uint8_t magic[LOG_MAGIC_SIZE];
+    reopen_log(highscores);
+    highscores->offset = LOG_MAGIC_SIZE;
+    highscores->records = 0;
+    highscores->count = 0;
+    if (highscores->damaged || pread(highscores->log_fd, magic, LOG_MAGIC_SIZE, 0) != LOG_MAGIC_SIZE
+      || memcmp(magic, LOG_MAGIC, LOG_MAGIC_SIZE) != 0)
+    {
+      // not a log that can be appended to, the next change replaces it
+      use_initial(highscores);
+      highscores->damaged = true;
+      return;
+    }
+  }
+  read_records(highscores);
+}
+
+// ----------------------------------------------------------------------------
+// Takes the lock of the log, creating the lock file if needed
+//
+// @return  false if the lock can not be taken
+//
+static bool lock_log(Highscores* highscores)
+{
+  if (highscores->lock_fd < 0)
+  {
+    highscores->lock_fd = open(highscores->lock_path, O_RDWR | O_CREAT, 0644);
+  }
+  struct flock lock;
+  memset(&lock, 0, sizeof(lock));
+  lock.l_type = F_WRLCK;
+  lock.l_whence = SEEK_SET;
+  while (highscores->lock_fd >= 0 && fcntl(highscores->lock_fd, F_SETLKW, &lock) != 0)
+  {
+    if (errno != EINTR)
+    {
+      return false;
+    }
+  }
+  return highscores->lock_fd >= 0;
+}
+
+// ----------------------------------------------------------------------------
+static void unlock_log(Highscores* highscores)
+{
+  struct flock lock;
+  memset(&lock, 0, sizeof(lock));
+  lock.l_type = F_UNLCK;
+  lock.l_whence = SEEK_SET;
+  fcntl(highscores->lock_fd, F_SETLK, &lock);
+}
+
+// ----------------------------------------------------------------------------
+// Appends an entry that was put into the table to the log
+//
+static void append_record(Highscores* highscores, const HighscoreEntry* entry)
+{
+  uint8_t record[RECORD_SIZE];
+  encode_record(entry, record);
+  if (highscores->log_fd >= 0 && !highscores->damaged)
+  {
+    // one write, so other processes never see a part of it
+    if (write(highscores->log_fd, record, RECORD_SIZE) == RECORD_SIZE && fdatasync(highscores->log_fd) == 0)
+    {
+      highscores->records++;
+      highscores->offset += RECORD_SIZE;
+    }
+    else
+    {
+      highscores->damaged = true;
+    }
+  }
+  if (highscores->log_fd < 0 || highscores->damaged
+    || highscores->records >= highscores->capacity + HIGHSCORE_COMPACT_RECORDS)
+  {
+    compact_log(highscores);
+  }
+}
+
+// ----------------------------------------------------------------------------
+static char* append_text(const char* text, const char* suffix)
+{
+  size_t length = strlen(text);
+  char* result = (char*) malloc(length + strlen(suffix) + 1);
+  if (result != NULL)
+  {
+    memcpy(result, text, length);
+    strcpy(result + length, suffix);
+  }
+  return result;
+}
+
+// ----------------------------------------------------------------------------
+bool highscores_open(Highscores* highscores, const char* config, uint32_t number, const Level* level)
+{
+  // ".<number>" of a level in a pack
+  char suffix[16 + sizeof(HIGHSCORE_SUFFIX)];
+  if (number > 0)
+  {
+    snprintf(suffix, sizeof(suffix), ".%u%s", number, HIGHSCORE_SUFFIX);
+  }
+  else
+  {
+    snprintf(suffix, sizeof(suffix), "%s", HIGHSCORE_SUFFIX);
+  }
+  memset(highscores, 0, sizeof(Highscores));
+  pthread_mutex_init(&highscores->lock, NULL);
+  highscores->lock_fd = -1;
+  highscores->log_fd = -1;
+  highscores->capacity = level->submissions;
+  // at least one entry, so the arrays are never of size 0
+  highscores->entries = (HighscoreEntry*) malloc((level->submissions + 1u) * sizeof(HighscoreEntry));
+  highscores->initial = (HighscoreEntry*) malloc((level->submissions + 1u) * sizeof(HighscoreEntry));
+  highscores->path = append_text(config, suffix);
+  highscores->lock_path = (highscores->path == NULL) ? NULL : append_text(highscores->path, ".lock");
+  highscores->temporary_path = (highscores->path == NULL) ? NULL : append_text(highscores->path, ".tmp");
+  if (highscores->entries == NULL || highscores->initial == NULL || highscores->lock_path == NULL
+    || highscores->temporary_path == NULL)
+  {
+    highscores_close(highscores);
+    return false;
+  }
+
+  for (size_t i = 0; i < level->submissions; i++)
+  {
+    HighscoreEntry* entry = &highscores->initial[highscores->initial_count];
+    entry->score = level->highscores[i * 4];
+    memcpy(entry->name, &level->highscores[i * 4 + 1], HIGHSCORE_NAME_SIZE);
+    // the placeholders of the generator are free places
+    if (memcmp(entry->name, HIGHSCORE_FREE, HIGHSCORE_NAME_SIZE) != 0)
+    {
+      highscores->initial_count++;
+    }
+  }
+  use_initial(highscores);
+
+  // a level that was never played has no log and no lock file
+  struct stat info;
+  if (stat(highscores->path, &info) == 0 && lock_log(highscores))
+  {
+    sync_log(highscores);
+    unlock_log(highscores);
+  }
+  return true;
+}
+
+// ----------------------------------------------------------------------------
+bool highscores_qualifies(Highscores* highscores, uint32_t score)
+{
+  pthread_mutex_lock(&highscores->lock);
+  size_t position = 0;
+  while (position < highscores->count && highscores->entries[position].score <= score)
+  {
+    position++;
+  }
+  bool qualifies = position < highscores->capacity;
+  pthread_mutex_unlock(&highscores->lock);
+  return qualifies;
+}
+
+// ----------------------------------------------------------------------------
+bool highscores_add(Highscores* highscores, uint32_t score, const char* name)
+{
+  HighscoreEntry entry;
+  entry.score = score;
+  memcpy(entry.name, name, HIGHSCORE_NAME_SIZE);
+  pthread_mutex_lock(&highscores->lock);
+  bool added = false;
+  if (highscores->capacity > 0 && lock_log(highscores))
+  {
+    sync_log(highscores);
+    added = insert_entry(highscores, &entry);
+    if (added)
+    {
+      append_record(highscores, &entry);
+    }
+    unlock_log(highscores);
+  }
+  else
+  {
+    added = insert_entry(highscores, &entry);
+  }
+  pthread_mutex_unlock(&highscores->lock);
+  return added;
+}
+
+// ----------------------------------------------------------------------------
+size_t highscores_top(Highscores* highscores, HighscoreEntry* entries, size_t count)
+{
+  pthread_mutex_lock(&highscores->lock);
+  count = (count < highscores->count) ? count : highscores->count;
+  memcpy(entries, highscores->entries, count * sizeof(HighscoreEntry));
+  pthread_mutex_unlock(&highscores->lock);
+  return count;
+}
+
+// ----------------------------------------------------------------------------
+void highscores_close(Highscores* highscores)
+{
+  if (highscores->log_fd >= 0)
+  {
+    close(highscores->log_fd);
+  }
+  if (highscores->lock_fd >= 0)
+  {
+    close(highscores->lock_fd);
+  }
+  pthread_mutex_destroy(&highscores->lock);
+  free(highscores->entries);
+  free(highscores->initial);
+  free(highscores->path);
+  free(highscores->lock_path);
+  free(highscores->temporary_path);
+}
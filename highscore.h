@@ -0,0 +1,123 @@
+#ifndef HIGHSCORE_H
+#define HIGHSCORE_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "level.h"
+
+#define HIGHSCORE_NAME_SIZE 3
+
+// name of the entries of a config file that are free places, the score of
+// the first player that finishes makes it into the table
+#define HIGHSCORE_FREE "---"
+
+// the log of a config file is its path with this appended, the one of a
+// level in a pack its path with ".<number of the level>" and this appended
+#define HIGHSCORE_SUFFIX ".highscores"
+
+// the log is compacted once it has this many records more than the table
+#define HIGHSCORE_COMPACT_RECORDS 64
+
+// ----------------------------------------------------------------------------
+// One line of the highscore table, <name> is not terminated
+//
+typedef struct _HighscoreEntry_
+{
+  uint32_t score;
+  char name[HIGHSCORE_NAME_SIZE];
+} HighscoreEntry;
+
+// ----------------------------------------------------------------------------
+// The highscore table of a level, kept in memory and in a log next to the
+// config file
+//
+// The config file is only read, its table is where a level starts as long
+// as it has no log. Every entry that makes it into the table is appended to
+// the log as a record of 8 bytes: the score as 32 bit little endian, the
+// name and a check byte. A record that was cut off or damaged by a crash
+// ends the log when it is read, everything before it is kept. Once the log
+// has HIGHSCORE_COMPACT_RECORDS records more than the table, it is replaced
+// by a log of just the table, written to a temporary file that is renamed
+// over the log, so a crash leaves either the old or the new one.
+//
+// Changes are made under a lock on <log>.lock, so several processes can
+// share a log; the records of the others are read before every change. The
+// table in memory is guarded by a mutex and can be used by many threads.
+// If the log can not be written, the table is only kept in memory.
+//
+typedef struct _Highscores_
+{
+  pthread_mutex_t lock;
+  char* path;                 // the log
+  char* lock_path;
+  char* temporary_path;
+  int lock_fd;                // -1 if the table is only kept in memory
+  int log_fd;                 // -1 if there is no log yet
+  dev_t device;               // of the open log, to notice a compaction
+  ino_t inode;
+  off_t offset;               // bytes of the log that are in <entries>
+  size_t records;             // records in the log
+  bool damaged;               // the log has to be compacted before appending
+  HighscoreEntry* entries;    // best first
+  size_t count;
+  size_t capacity;
+  HighscoreEntry* initial;    // the table of the config file
+  size_t initial_count;
+} Highscores;
+
+// ----------------------------------------------------------------------------
+// Loads the highscores of a level from its log, or from the config file if
+// there is no log yet
+//
+// @param highscores  the highscores to fill
+// @param config      path of the config file or level pack
+// @param number      number of the level in the pack, starting at 1, 0 for
+//                    a config file
+// @param level       the loaded config file, only read during the call
+// @return            false if out of memory
+//
+bool highscores_open(Highscores* highscores, const char* config, uint32_t number, const Level* level);
+
+// ----------------------------------------------------------------------------
+// @param highscores  the highscores
+// @param score       a score
+// @return            true if the score would make it into the table
+//
+bool highscores_qualifies(Highscores* highscores, uint32_t score);
+
+// ----------------------------------------------------------------------------
+// Puts a score into the table, behind the entries with the same score, and
+// appends it to the log
+//
+// The log is read first, so a score that no longer makes it into the table
+// because of another process is not added.
+//
+// @param highscores  the highscores
+// @param score       the score
+// @param name        3 letters, not terminated
+// @return            true if the score is in the table now
+//
+bool highscores_add(Highscores* highscores, uint32_t score, const char* name);
+
+// ----------------------------------------------------------------------------
+// Copies the best entries of the table, without reading the log
+//
+// @param highscores  the highscores
+// @param entries     set to the entries, best first
+// @param count       size of <entries>
+// @return            number of entries copied
+//
+size_t highscores_top(Highscores* highscores, HighscoreEntry* entries, size_t count);
+
+// ----------------------------------------------------------------------------
+// Closes the log and frees the table
+//
+// @param highscores  the highscores
+//
+void highscores_close(Highscores* highscores);
+
+#endif
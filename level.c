@@ -0,0 +1,633 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "level.h"
+
+// ----------------------------------------------------------------------------
+static uint32_t read_little_endian(const uint8_t* bytes)
+{
+  return (uint32_t) bytes[0] | (uint32_t) bytes[1] << 8 | (uint32_t) bytes[2] << 16 | (uint32_t) bytes[3] << 24;
+}
+
+// ----------------------------------------------------------------------------
+static uint64_t read_little_endian_64(const uint8_t* bytes)
+{
+  return (uint64_t) read_little_endian(bytes) | (uint64_t) read_little_endian(bytes + 4) << 32;
+}
+
+// ----------------------------------------------------------------------------
+static void write_little_endian(uint8_t* bytes, uint32_t value)
+{
+  bytes[0] = (uint8_t) value;
+  bytes[1] = (uint8_t) (value >> 8);
+  bytes[2] = (uint8_t) (value >> 16);
+  bytes[3] = (uint8_t) (value >> 24);
+}
+
+// ----------------------------------------------------------------------------
+// Fields of the openings stored in a nibble, bit 3 is the top opening
+//
+static const uint8_t UNPACKED_FIELDS[16] =
+{
+  0x00, 0x02, 0x08, 0x0A, 0x20, 0x22, 0x28, 0x2A, 0x80, 0x82, 0x88, 0x8A, 0xA0, 0xA2, 0xA8, 0xAA
+};
+
+// offset of the checksum in a version 2 header
+#define CHECKSUM_OFFSET 36
+
+// bits of the length of a wall run per nibble, the top bit marks that
+// another nibble follows
+#define RUN_BITS 3
+#define RUN_MORE 0x08
+
+// ----------------------------------------------------------------------------
+// The openings of a field as nibble, the connection bits are dropped
+//
+static uint8_t pack_field(uint8_t field)
+{
+  return (uint8_t) ((field >> 4 & 0x08) | (field >> 3 & 0x04) | (field >> 2 & 0x02) | (field >> 1 & 0x01));
+}
+
+// ----------------------------------------------------------------------------
+// Adds bytes to the sums of an Adler-32 checksum, without the modulo
+//
+static void add_checksum(uint32_t sums[2], const uint8_t* data, size_t size)
+{
+  for (size_t i = 0; i < size; i++)
+  {
+    sums[0] += data[i];
+    sums[1] += sums[0];
+  }
+}
+
+// ----------------------------------------------------------------------------
+// Adler-32 of the header and the highscore entries of a version 2 file,
+// without the checksum itself
+//
+// The map is left out, so loading does not read it twice. A damaged map is
+// still noticed as long as it no longer has the right size.
+//
+static uint32_t level_checksum(const uint8_t* data, uint8_t submissions)
+{
+  uint32_t sums[2] = { 1, 0 };
+  add_checksum(sums, data, CHECKSUM_OFFSET);
+  add_checksum(sums, data + LEVEL_HEADER_SIZE_V2, submissions * 4u);
+  // a header and 255 entries are too short to overflow the sums
+  return (sums[1] % 65521) << 16 | (sums[0] % 65521);
+}
+
+// ----------------------------------------------------------------------------
+// Writes nibbles, high nibble first, or only counts them if <data> is NULL
+//
+typedef struct _Nibbles_
+{
+  uint8_t* data;
+  size_t count;
+} Nibbles;
+
+// ----------------------------------------------------------------------------
+static void put_nibble(Nibbles* nibbles, uint8_t nibble)
+{
+  if (nibbles->data != NULL)
+  {
+    uint8_t* byte = &nibbles->data[nibbles->count / 2];
+    *byte = (nibbles->count % 2 == 0) ? (uint8_t) (nibble << 4) : (uint8_t) (*byte | nibble);
+  }
+  nibbles->count++;
+}
+
+// ----------------------------------------------------------------------------
+// Packs the fields with runs of walls stored as a 0 nibble followed by the
+// length - 1, RUN_BITS per nibble, lowest bits first
+//
+static void pack_wall_runs(Nibbles* nibbles, const uint8_t* fields, size_t count)
+{
+  for (size_t i = 0; i < count;)
+  {
+    uint8_t nibble = pack_field(fields[i]);
+    put_nibble(nibbles, nibble);
+    if (nibble != 0)
+    {
+      i++;
+      continue;
+    }
+    size_t run = 1;
+    while (i + run < count && pack_field(fields[i + run]) == 0)
+    {
+      run++;
+    }
+    i += run;
+    for (run--; run >= RUN_MORE; run >>= RUN_BITS)
+    {
+      put_nibble(nibbles, (uint8_t) (RUN_MORE | (run & (RUN_MORE - 1))));
+    }
+    put_nibble(nibbles, (uint8_t) run);
+  }
+}
+
+// ----------------------------------------------------------------------------
+// Unpacks a map stored as runs of walls, see pack_wall_runs
+//
+// @param fields  the unpacked map, has to be zeroed
+// @return  false if the map does not exactly fill <count> fields
+//
+static bool unpack_wall_runs(uint8_t* fields, size_t count, const uint8_t* map, size_t size)
+{
+  size_t nibbles = size * 2;
+  size_t next = 0;
+  size_t i = 0;
+  while (i < count)
+  {
+    if (next == nibbles)
+    {
+      return false;
+    }
+    uint8_t nibble = (map[next / 2] >> (next % 2 == 0 ? 4 : 0)) & 0x0F;
+    next++;
+    if (nibble != 0)
+    {
+      fields[i++] = UNPACKED_FIELDS[nibble];
+      continue;
+    }
+    size_t run = 0;
+    unsigned shift = 0;
+    do
+    {
+      if (next == nibbles || shift > 8 * sizeof(uint32_t))
+      {
+        return false;
+      }
+      nibble = (map[next / 2] >> (next % 2 == 0 ? 4 : 0)) & 0x0F;
+      next++;
+      run |= (size_t) (nibble & (RUN_MORE - 1)) << shift;
+      shift += RUN_BITS;
+    } while (nibble & RUN_MORE);
+    if (run >= count - i)
+    {
+      return false;
+    }
+    i += run + 1;   // <fields> are zeroed already
+  }
+  // only a padding nibble may be left
+  return nibbles - next == 0 || (nibbles - next == 1 && (map[size - 1] & 0x0F) == 0);
+}
+
+// ----------------------------------------------------------------------------
+// Unpacks the map of a version 2 file into <level->unpacked>
+//
+static LevelError unpack_fields(Level* level, const uint8_t* map, size_t size, uint8_t flags)
+{
+  size_t count = (size_t) level->width * level->height;
+  if ((flags & ~LEVEL_FLAG_WALL_RUNS) != 0 || (!(flags & LEVEL_FLAG_WALL_RUNS) && size != (count + 1) / 2))
+  {
+    return LEVEL_ERROR_INVALID;
+  }
+  // fresh pages from calloc are zero anyway, so walls cost nothing
+  uint8_t* fields = (uint8_t*) calloc(count, 1);
+  if (fields == NULL)
+  {
+    return LEVEL_ERROR_MEMORY;
+  }
+  if (flags & LEVEL_FLAG_WALL_RUNS)
+  {
+    if (!unpack_wall_runs(fields, count, map, size))
+    {
+      free(fields);
+      return LEVEL_ERROR_INVALID;
+    }
+  }
+  else
+  {
+    for (size_t i = 0; i < count / 2; i++)
+    {
+      fields[2 * i] = UNPACKED_FIELDS[map[i] >> 4];
+      fields[2 * i + 1] = UNPACKED_FIELDS[map[i] & 0x0F];
+    }
+    if (count % 2 != 0)
+    {
+      fields[count - 1] = UNPACKED_FIELDS[map[count / 2] >> 4];
+    }
+  }
+  level->unpacked = fields;
+  level->fields = fields;
+  return LEVEL_OK;
+}
+
+// ----------------------------------------------------------------------------
+// Reads a file that can not be mapped (e.g. a pipe) into memory
+//
+static void* read_whole_file(int fd, size_t* size)
+{
+  size_t capacity = 4096;
+  size_t length = 0;
+  uint8_t* buffer = (uint8_t*) malloc(capacity);
+  while (buffer != NULL)
+  {
+    ssize_t got = read(fd, buffer + length, capacity - length);
+    if (got <= 0)
+    {
+      if (got == 0)
+      {
+        *size = length;
+        return buffer;
+      }
+      break;
+    }
+    length += (size_t) got;
+    if (length == capacity)
+    {
+      capacity *= 2;
+      uint8_t* grown = (uint8_t*) realloc(buffer, capacity);
+      if (grown == NULL)
+      {
+        break;
+      }
+      buffer = grown;
+    }
+  }
+  free(buffer);
+  return NULL;
+}
+
+// ----------------------------------------------------------------------------
+static LevelError parse_header(Level* level, const uint8_t* data, size_t size)
+{
+  uint8_t flags = 0;
+  level->data = data;
+  level->size = size;
+  if (size < LEVEL_HEADER_SIZE_V0 || memcmp(data, LEVEL_MAGIC, LEVEL_MAGIC_SIZE) != 0)
+  {
+    return LEVEL_ERROR_INVALID;
+  }
+
+  if (data[7] != 0)   // a width of 0 marks a versioned header
+  {
+    level->version = 0;
+    level->header_size = LEVEL_HEADER_SIZE_V0;
+    level->width = data[7];
+    level->height = data[8];
+    level->start[0] = data[9];
+    level->start[1] = data[10];
+    level->dest[0] = data[11];
+    level->dest[1] = data[12];
+    level->submissions = data[13];
+  }
+  else if ((data[8] == 1 && size >= LEVEL_HEADER_SIZE_V1) || (data[8] == 2 && size >= LEVEL_HEADER_SIZE_V2))
+  {
+    level->version = data[8];
+    level->header_size = (data[8] == 1) ? LEVEL_HEADER_SIZE_V1 : LEVEL_HEADER_SIZE_V2;
+    level->submissions = data[9];
+    level->width = read_little_endian(&data[10]);
+    level->height = read_little_endian(&data[14]);
+    level->start[0] = read_little_endian(&data[18]);
+    level->start[1] = read_little_endian(&data[22]);
+    level->dest[0] = read_little_endian(&data[26]);
+    level->dest[1] = read_little_endian(&data[30]);
+    if (level->version == 2)
+    {
+      flags = data[34];
+      if (data[35] != 0 || size < LEVEL_HEADER_SIZE_V2 + level->submissions * 4u
+        || read_little_endian(&data[CHECKSUM_OFFSET]) != level_checksum(data, level->submissions))
+      {
+        return LEVEL_ERROR_INVALID;
+      }
+    }
+  }
+  else
+  {
+    return LEVEL_ERROR_INVALID;
+  }
+
+  // fields are indexed with 32 bits
+  uint64_t fields = (uint64_t) level->width * level->height;
+  if (fields == 0 || fields > UINT32_MAX)
+  {
+    return LEVEL_ERROR_INVALID;
+  }
+  if (level->start[0] >= level->height || level->start[1] >= level->width
+    || level->dest[0] >= level->height || level->dest[1] >= level->width)
+  {
+    return LEVEL_ERROR_INVALID;
+  }
+  size_t map = level->header_size + level->submissions * 4u;
+  if (size < map || (level->version < 2 && size - map != fields))
+  {
+    return LEVEL_ERROR_INVALID;
+  }
+
+  level->highscores = data + level->header_size;
+  level->fields = data + map;
+  if (level->version == 2)
+  {
+    return unpack_fields(level, data + map, size - map, flags);
+  }
+  return LEVEL_OK;
+}
+
+// ----------------------------------------------------------------------------
+LevelError level_parse(Level* level, const uint8_t* data, size_t size)
+{
+  level->mapping = NULL;
+  level->buffer = NULL;
+  level->unpacked = NULL;
+  return parse_header(level, data, size);
+}
+
+// ----------------------------------------------------------------------------
+// Maps a file, or reads it into memory if it can not be mapped
+//
+// @param mapping  set to the mapping of <data>, NULL if it was read
+// @param buffer   set to the memory of <data>, NULL if it was mapped
+//
+static LevelError map_file(const char* path, const uint8_t** data, size_t* size, void** mapping, void** buffer)
+{
+  struct stat info;
+  *mapping = NULL;
+  *buffer = NULL;
+  int fd = open(path, O_RDONLY);
+  if (fd < 0)
+  {
+    return LEVEL_ERROR_OPEN;
+  }
+  if (fstat(fd, &info) != 0)
+  {
+    close(fd);
+    return LEVEL_ERROR_OPEN;
+  }
+
+  *data = NULL;
+  *size = (size_t) info.st_size;
+  if (S_ISREG(info.st_mode) && *size > 0)
+  {
+    void* mapped = mmap(NULL, *size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapped != MAP_FAILED)
+    {
+      *mapping = mapped;
+      *data = (const uint8_t*) mapped;
+    }
+  }
+  if (*data == NULL)
+  {
+    *buffer = read_whole_file(fd, size);
+    *data = (const uint8_t*) *buffer;
+  }
+  close(fd);
+  return (*data == NULL) ? LEVEL_ERROR_MEMORY : LEVEL_OK;
+}
+
+// ----------------------------------------------------------------------------
+LevelError level_open(Level* level, const char* path)
+{
+  const uint8_t* data = NULL;
+  size_t size = 0;
+  level->unpacked = NULL;
+  LevelError error = map_file(path, &data, &size, &level->mapping, &level->buffer);
+  if (error != LEVEL_OK)
+  {
+    return error;
+  }
+  error = parse_header(level, data, size);
+  if (error != LEVEL_OK)
+  {
+    level_close(level);
+  }
+  return error;
+}
+
+// ----------------------------------------------------------------------------
+uint8_t* level_serialize(const Level* level, size_t* size)
+{
+  uint8_t header[LEVEL_HEADER_SIZE_V2] = { 0 };
+  size_t header_size;
+  memcpy(header, LEVEL_MAGIC, LEVEL_MAGIC_SIZE);
+  if (level->version == 0)
+  {
+    uint32_t values[6] = { level->width, level->height, level->start[0], level->start[1], level->dest[0], level->dest[1] };
+    for (int i = 0; i < 6; i++)
+    {
+      if (values[i] > UINT8_MAX)
+      {
+        return NULL;
+      }
+      header[7 + i] = (uint8_t) values[i];
+    }
+    header[13] = level->submissions;
+    header_size = LEVEL_HEADER_SIZE_V0;
+  }
+  else if (level->version == 1 || level->version == 2)
+  {
+    header[8] = level->version;
+    header[9] = level->submissions;
+    write_little_endian(&header[10], level->width);
+    write_little_endian(&header[14], level->height);
+    write_little_endian(&header[18], level->start[0]);
+    write_little_endian(&header[22], level->start[1]);
+    write_little_endian(&header[26], level->dest[0]);
+    write_little_endian(&header[30], level->dest[1]);
+    header_size = (level->version == 1) ? LEVEL_HEADER_SIZE_V1 : LEVEL_HEADER_SIZE_V2;
+  }
+  else
+  {
+    return NULL;
+  }
+  if (level->width == 0 || level->height == 0)
+  {
+    return NULL;
+  }
+
+  size_t fields = (size_t) level->width * level->height;
+  size_t highscores = level->submissions * 4u;
+  size_t map = fields;
+  Nibbles runs = { NULL, 0 };
+  if (level->version == 2)
+  {
+    pack_wall_runs(&runs, level->fields, fields);
+    map = (runs.count < fields) ? (runs.count + 1) / 2 : (fields + 1) / 2;
+    header[34] = (runs.count < fields) ? LEVEL_FLAG_WALL_RUNS : 0;
+  }
+  *size = header_size + highscores + map;
+  uint8_t* data = (uint8_t*) malloc(*size);
+  if (data == NULL)
+  {
+    return NULL;
+  }
+  memcpy(data, header, header_size);
+  if (highscores > 0)
+  {
+    memcpy(data + header_size, level->highscores, highscores);
+  }
+  if (level->version < 2)
+  {
+    memcpy(data + header_size + highscores, level->fields, fields);
+    return data;
+  }
+
+  Nibbles nibbles = { data + header_size + highscores, 0 };
+  if (header[34] & LEVEL_FLAG_WALL_RUNS)
+  {
+    pack_wall_runs(&nibbles, level->fields, fields);
+  }
+  else
+  {
+    for (size_t i = 0; i < fields; i++)
+    {
+      put_nibble(&nibbles, pack_field(level->fields[i]));
+    }
+  }
+  if (nibbles.count % 2 != 0)
+  {
+    put_nibble(&nibbles, 0);
+  }
+  write_little_endian(&data[CHECKSUM_OFFSET], level_checksum(data, level->submissions));
+  return data;
+}
+
+// ----------------------------------------------------------------------------
+LevelError level_save(const Level* level, const char* path)
+{
+  size_t size = 0;
+  uint8_t* data = level_serialize(level, &size);
+  if (data == NULL)
+  {
+    return LEVEL_ERROR_INVALID;
+  }
+  FILE* file = fopen(path, "wb");
+  if (file == NULL)
+  {
+    free(data);
+    return LEVEL_ERROR_OPEN;
+  }
+  bool written = fwrite(data, 1, size, file) == size;
+  free(data);
+  if (fclose(file) != 0 || !written)
+  {
+    return LEVEL_ERROR_OPEN;
+  }
+  return LEVEL_OK;
+}
+
+// ----------------------------------------------------------------------------
+void level_close(Level* level)
+{
+  if (level->mapping != NULL)
+  {
+    munmap(level->mapping, level->size);
+  }
+  free(level->buffer);
+  free(level->unpacked);
+  level->mapping = NULL;
+  level->buffer = NULL;
+  level->unpacked = NULL;
+  level->data = NULL;
+  level->highscores = NULL;
+  level->fields = NULL;
+}
+
+// ----------------------------------------------------------------------------
+LevelError level_pack_open(LevelPack* pack, const char* path)
+{
+  LevelError error = map_file(path, &pack->data, &pack->size, &pack->mapping, &pack->buffer);
+  if (error != LEVEL_OK)
+  {
+    return error;
+  }
+  pack->count = 1;
+  pack->indexed = false;
+  pack->index = NULL;
+  if (pack->size >= LEVEL_MAGIC_SIZE && memcmp(pack->data, LEVEL_MAGIC, LEVEL_MAGIC_SIZE) == 0)
+  {
+    return LEVEL_OK;
+  }
+  if (pack->size < LEVEL_PACK_HEADER_SIZE || memcmp(pack->data, LEVEL_PACK_MAGIC, LEVEL_PACK_MAGIC_SIZE) != 0)
+  {
+    level_pack_close(pack);
+    return LEVEL_ERROR_INVALID;
+  }
+  pack->count = read_little_endian(&pack->data[LEVEL_PACK_MAGIC_SIZE]);
+  pack->indexed = true;
+  pack->index = pack->data + LEVEL_PACK_HEADER_SIZE;
+  if (pack->count == 0 || (pack->size - LEVEL_PACK_HEADER_SIZE) / LEVEL_PACK_ENTRY_SIZE < pack->count)
+  {
+    level_pack_close(pack);
+    return LEVEL_ERROR_INVALID;
+  }
+  return LEVEL_OK;
+}
+
+// ----------------------------------------------------------------------------
+LevelError level_pack_get(const LevelPack* pack, uint32_t index, Level* level)
+{
+  if (index >= pack->count)
+  {
+    return LEVEL_ERROR_OPEN;
+  }
+  if (!pack->indexed)
+  {
+    return level_parse(level, pack->data, pack->size);
+  }
+  const uint8_t* entry = pack->index + (size_t) index * LEVEL_PACK_ENTRY_SIZE;
+  uint64_t offset = read_little_endian_64(entry);
+  uint64_t size = read_little_endian_64(entry + 8);
+  if (offset > pack->size || size > pack->size - offset)
+  {
+    return LEVEL_ERROR_INVALID;
+  }
+  return level_parse(level, pack->data + offset, (size_t) size);
+}
+
+// ----------------------------------------------------------------------------
+uint8_t* level_pack_serialize(const uint8_t* const* files, const size_t* sizes, uint32_t count, size_t* size)
+{
+  *size = LEVEL_PACK_HEADER_SIZE + (size_t) count * LEVEL_PACK_ENTRY_SIZE;
+  for (uint32_t i = 0; i < count; i++)
+  {
+    Level level;
+    if (level_parse(&level, files[i], sizes[i]) != LEVEL_OK)
+    {
+      return NULL;
+    }
+    level_close(&level);
+    *size += sizes[i];
+  }
+  uint8_t* data = (uint8_t*) malloc(*size);
+  if (count == 0 || data == NULL)
+  {
+    free(data);
+    return NULL;
+  }
+  memcpy(data, LEVEL_PACK_MAGIC, LEVEL_PACK_MAGIC_SIZE);
+  write_little_endian(&data[LEVEL_PACK_MAGIC_SIZE], count);
+  size_t offset = LEVEL_PACK_HEADER_SIZE + (size_t) count * LEVEL_PACK_ENTRY_SIZE;
+  for (uint32_t i = 0; i < count; i++)
+  {
+    uint8_t* entry = data + LEVEL_PACK_HEADER_SIZE + (size_t) i * LEVEL_PACK_ENTRY_SIZE;
+    write_little_endian(entry, (uint32_t) offset);
+    write_little_endian(entry + 4, (uint32_t) ((uint64_t) offset >> 32));
+    write_little_endian(entry + 8, (uint32_t) sizes[i]);
+    write_little_endian(entry + 12, (uint32_t) ((uint64_t) sizes[i] >> 32));
+    memcpy(data + offset, files[i], sizes[i]);
+    offset += sizes[i];
+  }
+  return data;
+}
+
+// ----------------------------------------------------------------------------
+void level_pack_close(LevelPack* pack)
+{
+  if (pack->mapping != NULL)
+  {
+    munmap(pack->mapping, pack->size);
+  }
+  free(pack->buffer);
+  pack->mapping = NULL;
+  pack->buffer = NULL;
+  pack->data = NULL;
+  pack->index = NULL;
+}
@@ -0,0 +1,179 @@
+#ifndef LEVEL_H
+#define LEVEL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define LEVEL_MAGIC      "ESPipes"
+#define LEVEL_MAGIC_SIZE 7
+
+// size of the header in front of the highscore entries, see README.md
+#define LEVEL_HEADER_SIZE_V0 14
+#define LEVEL_HEADER_SIZE_V1 34
+#define LEVEL_HEADER_SIZE_V2 40
+
+// a level pack starts with this, see README.md
+#define LEVEL_PACK_MAGIC       "ESLevels"
+#define LEVEL_PACK_MAGIC_SIZE  8
+#define LEVEL_PACK_HEADER_SIZE 12
+#define LEVEL_PACK_ENTRY_SIZE  16
+
+// flags of a version 2 file
+#define LEVEL_FLAG_WALL_RUNS 0x01   // runs of walls are stored as their length
+
+typedef enum _LevelError_
+{
+  LEVEL_OK,
+  LEVEL_ERROR_OPEN,     // file can not be opened or read
+  LEVEL_ERROR_INVALID,  // wrong magic word, unknown version, wrong sizes or
+                        // checksum
+  LEVEL_ERROR_MEMORY
+} LevelError;
+
+// ----------------------------------------------------------------------------
+// A loaded config file
+//
+// The file is mapped (or read in one go, if it can not be mapped) and
+// <highscores> and <fields> point directly into it, nothing is copied.
+// Version 2 files only store the openings of every field, their <fields>
+// are unpacked into memory and carry no connection bits. Both stay valid
+// until level_close is called.
+//
+typedef struct _Level_
+{
+  uint8_t version;
+  uint32_t width;
+  uint32_t height;
+  uint32_t start[2];
+  uint32_t dest[2];
+  uint8_t submissions;
+  size_t header_size;         // offset of the highscore entries
+  const uint8_t* highscores;  // <submissions> entries of 4 bytes
+  const uint8_t* fields;      // <width> * <height> fields, row by row
+  const uint8_t* data;        // the whole file
+  size_t size;
+  void* mapping;              // set if <data> was mapped
+  void* buffer;               // set if <data> was read into memory
+  void* unpacked;             // set if <fields> were unpacked from <data>
+} Level;
+
+// ----------------------------------------------------------------------------
+// A loaded level pack, or a single config file that is used like a pack of
+// one level
+//
+// The file is mapped like the one of a level. Only the header is checked
+// when it is opened, an entry of the index is checked when its level is
+// taken, so opening a pack costs the same for any number of levels.
+//
+typedef struct _LevelPack_
+{
+  uint32_t count;             // number of levels
+  bool indexed;               // false for a single config file
+  const uint8_t* index;       // <count> entries of LEVEL_PACK_ENTRY_SIZE
+  const uint8_t* data;        // the whole file
+  size_t size;
+  void* mapping;              // set if <data> was mapped
+  void* buffer;               // set if <data> was read into memory
+} LevelPack;
+
+// ----------------------------------------------------------------------------
+// Maps a config file and checks its header against the file size
+//
+// @param level   the level to fill
+// @param path    path of the config file
+// @return        LEVEL_OK on success, otherwise the reason of the failure
+//
+LevelError level_open(Level* level, const char* path);
+
+// ----------------------------------------------------------------------------
+// Checks and parses a config file that is already in memory
+//
+// <data> is not copied and has to outlive <level>. level_close has to be
+// called on success, it does not free <data>.
+//
+// @param level   the level to fill
+// @param data    contents of the config file
+// @param size    size of <data> in bytes
+// @return        LEVEL_OK on success, LEVEL_ERROR_MEMORY if the fields of a
+//                version 2 file can not be unpacked, otherwise
+//                LEVEL_ERROR_INVALID
+//
+LevelError level_parse(Level* level, const uint8_t* data, size_t size);
+
+// ----------------------------------------------------------------------------
+// Builds the contents of a config file for a level
+//
+// Uses <version>, the sizes, start, dest, <submissions>, <highscores> and
+// <fields> of the level, the rest is ignored. A version 0 file can only
+// hold maps up to 255x255. A version 2 file drops the connection bits and
+// stores runs of walls as their length if that makes the file smaller.
+//
+// @param level   the level to write
+// @param size    set to the size of the returned data
+// @return        the file contents to be freed by the caller, NULL if out of
+//                memory or if the level does not fit into its version
+//
+uint8_t* level_serialize(const Level* level, size_t* size);
+
+// ----------------------------------------------------------------------------
+// Writes a level to a config file, see level_serialize
+//
+// @param level   the level to write
+// @param path    path of the config file, an existing file is replaced
+// @return        LEVEL_OK on success, LEVEL_ERROR_INVALID if the level does
+//                not fit into its version or out of memory, otherwise
+//                LEVEL_ERROR_OPEN
+//
+LevelError level_save(const Level* level, const char* path);
+
+// ----------------------------------------------------------------------------
+// Unmaps or frees the file of a level opened with level_open
+//
+// @param level   the level
+//
+void level_close(Level* level);
+
+// ----------------------------------------------------------------------------
+// Maps a level pack or a config file
+//
+// @param pack    the pack to fill
+// @param path    path of the level pack or config file
+// @return        LEVEL_OK on success, otherwise the reason of the failure
+//
+LevelError level_pack_open(LevelPack* pack, const char* path);
+
+// ----------------------------------------------------------------------------
+// Parses a level of a pack without copying it, see level_parse
+//
+// @param pack    the pack
+// @param index   number of the level, starting at 0
+// @param level   the level to fill, level_close has to be called on success
+//                and before the pack is closed
+// @return        LEVEL_OK on success, LEVEL_ERROR_OPEN if there is no such
+//                level, otherwise like level_parse
+//
+LevelError level_pack_get(const LevelPack* pack, uint32_t index, Level* level);
+
+// ----------------------------------------------------------------------------
+// Builds a level pack of config files
+//
+// The files are taken as they are, only the header of every one is checked.
+//
+// @param files   contents of the config files
+// @param sizes   size of every file
+// @param count   number of files
+// @param size    set to the size of the returned data
+// @return        the pack to be freed by the caller, NULL if out of memory or
+//                if a file is not a valid config file
+//
+uint8_t* level_pack_serialize(const uint8_t* const* files, const size_t* sizes, uint32_t count, size_t* size);
+
+// ----------------------------------------------------------------------------
+// Unmaps or frees the file of a pack
+//
+// @param pack    the pack
+//
+void level_pack_close(LevelPack* pack);
+
+#endif
@@ -0,0 +1,98 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "framework.h"
+#include "level.h"
+
+#define USAGE_PACKER "Usage: ./pack PACK_FILE CONFIG_FILE...\n"
+#define INFO_PACKED  "Packed %u levels into %zu bytes: %s\n"
+
+// ----------------------------------------------------------------------------
+// Writes the pack to a file, an existing file is replaced
+//
+// @return  false if the file can not be written
+//
+static bool save_pack(const char* path, const uint8_t* data, size_t size)
+{
+  FILE* file = fopen(path, "wb");
+  if (file == NULL)
+  {
+    return false;
+  }
+  bool written = fwrite(data, 1, size, file) == size;
+  return fclose(file) == 0 && written;
+}
+
+int main(int argc, char const **argv)
+{
+  if (argc < 3 || (size_t) argc - 2 > UINT32_MAX)
+  {
+    printf("%s", USAGE_PACKER);
+    return 1;
+  }
+
+  // the levels are taken over as they are, in the order of the arguments
+  uint32_t count = (uint32_t) (argc - 2);
+  Level* levels = (Level*) malloc(count * sizeof(Level));
+  const uint8_t** files = (const uint8_t**) malloc(count * sizeof(uint8_t*));
+  size_t* sizes = (size_t*) malloc(count * sizeof(size_t));
+  uint32_t opened = 0;
+  int result = (levels == NULL || files == NULL || sizes == NULL) ? 4 : 0;
+  if (result == 4)
+  {
+    printf("%s", ERROR_OUT_OF_MEMORY);
+  }
+  for (; result == 0 && opened < count; opened++)
+  {
+    const char* path = argv[opened + 2];
+    switch (level_open(&levels[opened], path))
+    {
+      case LEVEL_OK:
+        files[opened] = levels[opened].data;
+        sizes[opened] = levels[opened].size;
+        continue;
+      case LEVEL_ERROR_OPEN:
+        printf(ERROR_OPEN_FILE, path);
+        result = 2;
+        break;
+      case LEVEL_ERROR_INVALID:
+        printf(ERROR_INVALID_FILE, path);
+        result = 3;
+        break;
+      case LEVEL_ERROR_MEMORY:
+        printf("%s", ERROR_OUT_OF_MEMORY);
+        result = 4;
+        break;
+    }
+    break;
+  }
+
+  if (result == 0)
+  {
+    size_t size = 0;
+    uint8_t* data = level_pack_serialize(files, sizes, count, &size);
+    if (data == NULL)
+    {
+      printf("%s", ERROR_OUT_OF_MEMORY);
+      result = 4;
+    }
+    else if (!save_pack(argv[1], data, size))
+    {
+      printf(ERROR_OPEN_FILE, argv[1]);
+      result = 2;
+    }
+    else
+    {
+      printf(INFO_PACKED, count, size, argv[1]);
+    }
+    free(data);
+  }
+
+  for (uint32_t i = 0; i < opened; i++)
+  {
+    level_close(&levels[i]);
+  }
+  free(levels);
+  free(files);
+  free(sizes);
+  return result;
+}
@@ -0,0 +1,303 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "game.h"
+#include "level.h"
+#include "pipes.h"
+#include "solver.h"
+
+// ----------------------------------------------------------------------------
+// A game and what is needed to write it back as config file
+//
+struct _PipesGame_
+{
+  Game game;
+  uint8_t version;
+  uint8_t submissions;
+  uint8_t* highscores;
+};
+
+// ----------------------------------------------------------------------------
+struct _PipesPack_
+{
+  LevelPack pack;
+};
+
+// ----------------------------------------------------------------------------
+// Starts the game of a parsed level, the level is not needed afterwards
+//
+static PipesError start_game(PipesGame** game, const Level* level)
+{
+  PipesGame* handle = (PipesGame*) malloc(sizeof(PipesGame));
+  if (handle == NULL)
+  {
+    return PIPES_ERROR_MEMORY;
+  }
+  handle->version = level->version;
+  handle->submissions = level->submissions;
+  handle->highscores = (uint8_t*) malloc(level->submissions * 4u + 1u);
+  if (handle->highscores == NULL || !game_init(&handle->game, level))
+  {
+    free(handle->highscores);
+    free(handle);
+    return PIPES_ERROR_MEMORY;
+  }
+  memcpy(handle->highscores, level->highscores, level->submissions * 4u);
+
+  // the engine never uses the connections from the file, so the first move
+  // behaves like every other one
+  game_restart(&handle->game);
+  game_end_turn(&handle->game);
+  *game = handle;
+  return PIPES_OK;
+}
+
+// ----------------------------------------------------------------------------
+PipesError pipes_load_file(PipesGame** game, const char* path)
+{
+  Level level;
+  *game = NULL;
+  switch (level_open(&level, path))
+  {
+    case LEVEL_OK:
+      break;
+    case LEVEL_ERROR_OPEN:
+      return PIPES_ERROR_OPEN;
+    case LEVEL_ERROR_INVALID:
+      return PIPES_ERROR_INVALID;
+    case LEVEL_ERROR_MEMORY:
+      return PIPES_ERROR_MEMORY;
+  }
+  PipesError error = start_game(game, &level);
+  level_close(&level);
+  return error;
+}
+
+// ----------------------------------------------------------------------------
+PipesError pipes_load_memory(PipesGame** game, const uint8_t* data, size_t size)
+{
+  Level level;
+  *game = NULL;
+  switch (level_parse(&level, data, size))
+  {
+    case LEVEL_OK:
+      break;
+    case LEVEL_ERROR_MEMORY:
+      return PIPES_ERROR_MEMORY;
+    default:
+      return PIPES_ERROR_INVALID;
+  }
+  PipesError error = start_game(game, &level);
+  level_close(&level);
+  return error;
+}
+
+// ----------------------------------------------------------------------------
+PipesError pipes_pack_open(PipesPack** pack, const char* path)
+{
+  *pack = (PipesPack*) malloc(sizeof(PipesPack));
+  if (*pack == NULL)
+  {
+    return PIPES_ERROR_MEMORY;
+  }
+  LevelError error = level_pack_open(&(*pack)->pack, path);
+  if (error != LEVEL_OK)
+  {
+    free(*pack);
+    *pack = NULL;
+  }
+  switch (error)
+  {
+    case LEVEL_OK:
+      return PIPES_OK;
+    case LEVEL_ERROR_OPEN:
+      return PIPES_ERROR_OPEN;
+    case LEVEL_ERROR_INVALID:
+      return PIPES_ERROR_INVALID;
+    default:
+      return PIPES_ERROR_MEMORY;
+  }
+}
+
+// ----------------------------------------------------------------------------
+uint32_t pipes_pack_count(const PipesPack* pack)
+{
+  return pack->pack.count;
+}
+
+// ----------------------------------------------------------------------------
+PipesError pipes_pack_load(const PipesPack* pack, uint32_t level, PipesGame** game)
+{
+  Level loaded;
+  *game = NULL;
+  switch (level_pack_get(&pack->pack, level, &loaded))
+  {
+    case LEVEL_OK:
+      break;
+    case LEVEL_ERROR_OPEN:
+      return PIPES_ERROR_ARGUMENT;
+    case LEVEL_ERROR_INVALID:
+      return PIPES_ERROR_INVALID;
+    case LEVEL_ERROR_MEMORY:
+      return PIPES_ERROR_MEMORY;
+  }
+  PipesError error = start_game(game, &loaded);
+  level_close(&loaded);
+  return error;
+}
+
+// ----------------------------------------------------------------------------
+void pipes_pack_free(PipesPack* pack)
+{
+  if (pack == NULL)
+  {
+    return;
+  }
+  level_pack_close(&pack->pack);
+  free(pack);
+}
+
+// ----------------------------------------------------------------------------
+void pipes_free(PipesGame* game)
+{
+  if (game == NULL)
+  {
+    return;
+  }
+  game_free(&game->game);
+  free(game->highscores);
+  free(game);
+}
+
+// ----------------------------------------------------------------------------
+PipesError pipes_rotate(PipesGame* game, uint32_t row, uint32_t col, PipesDirection direction)
+{
+  Game* state = &game->game;
+  if (row >= state->grid.height || col >= state->grid.width
+    || (row == state->start[0] && col == state->start[1]) || (row == state->dest[0] && col == state->dest[1])
+    || (direction != PIPES_LEFT && direction != PIPES_RIGHT))
+  {
+    return PIPES_ERROR_ARGUMENT;
+  }
+  if (!game_rotate(state, row, col, (size_t) direction))
+  {
+    return PIPES_ERROR_MEMORY;
+  }
+  game_end_turn(state);
+  return PIPES_OK;
+}
+
+// ----------------------------------------------------------------------------
+PipesError pipes_undo(PipesGame* game)
+{
+  if (!game_undo(&game->game))
+  {
+    return PIPES_ERROR_NOTHING;
+  }
+  game_end_turn(&game->game);
+  return PIPES_OK;
+}
+
+// ----------------------------------------------------------------------------
+PipesError pipes_redo(PipesGame* game)
+{
+  if (!game_redo(&game->game))
+  {
+    return PIPES_ERROR_NOTHING;
+  }
+  game_end_turn(&game->game);
+  return PIPES_OK;
+}
+
+// ----------------------------------------------------------------------------
+void pipes_restart(PipesGame* game)
+{
+  game_restart(&game->game);
+  game_end_turn(&game->game);
+}
+
+// ----------------------------------------------------------------------------
+bool pipes_is_connected(const PipesGame* game)
+{
+  return game_is_solved(&game->game);
+}
+
+// ----------------------------------------------------------------------------
+uint32_t pipes_score(const PipesGame* game)
+{
+  return (uint32_t) (game->game.turn - 1);
+}
+
+// ----------------------------------------------------------------------------
+uint32_t pipes_width(const PipesGame* game)
+{
+  return game->game.grid.width;
+}
+
+// ----------------------------------------------------------------------------
+uint32_t pipes_height(const PipesGame* game)
+{
+  return game->game.grid.height;
+}
+
+// ----------------------------------------------------------------------------
+uint8_t pipes_field(const PipesGame* game, uint32_t row, uint32_t col)
+{
+  return grid_get(&game->game.grid, row, col);
+}
+
+// ----------------------------------------------------------------------------
+uint8_t* pipes_serialize(const PipesGame* game, size_t* size)
+{
+  Level level;
+  const Game* state = &game->game;
+  level.version = game->version;
+  level.width = state->grid.width;
+  level.height = state->grid.height;
+  level.start[0] = state->start[0];
+  level.start[1] = state->start[1];
+  level.dest[0] = state->dest[0];
+  level.dest[1] = state->dest[1];
+  level.submissions = game->submissions;
+  level.highscores = game->highscores;
+  level.fields = state->grid.fields;
+  return level_serialize(&level, size);
+}
+
+// ----------------------------------------------------------------------------
+PipesError pipes_solve(const PipesGame* game, PipesMove** moves, size_t* count)
+{
+  Solution solution;
+  *moves = NULL;
+  *count = 0;
+  switch (solver_solve(&game->game, false, &solution))
+  {
+    case SOLVER_OK:
+    case SOLVER_LIMIT:    // only with a budget
+      break;
+    case SOLVER_UNSOLVABLE:
+      return PIPES_ERROR_UNSOLVABLE;
+    case SOLVER_MEMORY:
+      return PIPES_ERROR_MEMORY;
+  }
+  if (solution.count > 0)
+  {
+    *moves = (PipesMove*) malloc(solution.count * sizeof(PipesMove));
+    if (*moves == NULL)
+    {
+      solution_free(&solution);
+      return PIPES_ERROR_MEMORY;
+    }
+  }
+  uint32_t width = game->game.grid.width;
+  for (size_t index = 0; index < solution.count; index++)
+  {
+    const Move* move = &solution.moves[index];
+    (*moves)[index].row = move->field / width;
+    (*moves)[index].col = move->field % width;
+    (*moves)[index].direction = (PipesDirection) move->direction;
+  }
+  *count = solution.count;
+  solution_free(&solution);
+  return PIPES_OK;
+}
@@ -0,0 +1,204 @@
+#ifndef PIPES_H
+#define PIPES_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// ----------------------------------------------------------------------------
+// Game engine API of a3.so
+//
+// Every game lives in its own handle, the functions keep no global state and
+// never print anything. Different handles can be used from different
+// threads at the same time, one handle must not be used by two threads at
+// once. Rows and columns start at 0.
+//
+typedef struct _PipesGame_ PipesGame;
+
+// ----------------------------------------------------------------------------
+// A mapped level pack, or a config file used as pack of one level
+//
+// Games loaded from a pack do not depend on it, it can be freed before them.
+// A pack is only read, so it can be used by many threads at once.
+//
+typedef struct _PipesPack_ PipesPack;
+
+typedef enum _PipesError_
+{
+  PIPES_OK,
+  PIPES_ERROR_OPEN,       // file can not be opened or read
+  PIPES_ERROR_INVALID,    // not a valid config file
+  PIPES_ERROR_MEMORY,
+  PIPES_ERROR_ARGUMENT,   // field outside of the map, start- or dest-pipe
+  PIPES_ERROR_NOTHING,    // nothing to undo or redo
+  PIPES_ERROR_UNSOLVABLE  // start- and dest-pipe can not be connected
+} PipesError;
+
+typedef enum _PipesDirection_
+{
+  PIPES_LEFT = 1,
+  PIPES_RIGHT = 3
+} PipesDirection;
+
+// ----------------------------------------------------------------------------
+// One rotation of a solution
+//
+typedef struct _PipesMove_
+{
+  uint32_t row;
+  uint32_t col;
+  PipesDirection direction;
+} PipesMove;
+
+// ----------------------------------------------------------------------------
+// Starts a game from a config file
+//
+// @param game    set to the new game, NULL on failure
+// @param path    path of the config file
+// @return        PIPES_OK on success, otherwise the reason of the failure
+//
+PipesError pipes_load_file(PipesGame** game, const char* path);
+
+// ----------------------------------------------------------------------------
+// Starts a game from the contents of a config file, <data> is copied
+//
+// @param game    set to the new game, NULL on failure
+// @param data    contents of the config file
+// @param size    size of <data> in bytes
+// @return        PIPES_OK on success, otherwise the reason of the failure
+//
+PipesError pipes_load_memory(PipesGame** game, const uint8_t* data, size_t size);
+
+// ----------------------------------------------------------------------------
+// Opens a level pack or a config file, see README.md
+//
+// @param pack    set to the new pack, NULL on failure
+// @param path    path of the level pack or config file
+// @return        PIPES_OK on success, otherwise the reason of the failure
+//
+PipesError pipes_pack_open(PipesPack** pack, const char* path);
+
+// ----------------------------------------------------------------------------
+// @param pack    the pack
+// @return        number of levels in the pack
+//
+uint32_t pipes_pack_count(const PipesPack* pack);
+
+// ----------------------------------------------------------------------------
+// Starts a game from a level of a pack
+//
+// @param pack    the pack
+// @param level   number of the level, starting at 0
+// @param game    set to the new game, NULL on failure
+// @return        PIPES_OK on success, PIPES_ERROR_ARGUMENT if there is no
+//                such level, otherwise the reason of the failure
+//
+PipesError pipes_pack_load(const PipesPack* pack, uint32_t level, PipesGame** game);
+
+// ----------------------------------------------------------------------------
+// Unmaps a pack, NULL is ignored
+//
+// @param pack    the pack
+//
+void pipes_pack_free(PipesPack* pack);
+
+// ----------------------------------------------------------------------------
+// Frees a game, NULL is ignored
+//
+// @param game    the game
+//
+void pipes_free(PipesGame* game);
+
+// ----------------------------------------------------------------------------
+// Rotates a pipe, this counts as one move
+//
+// @param game        the game
+// @param row         row of the pipe
+// @param col         column of the pipe
+// @param direction   the direction
+// @return            PIPES_OK, PIPES_ERROR_ARGUMENT or PIPES_ERROR_MEMORY
+//
+PipesError pipes_rotate(PipesGame* game, uint32_t row, uint32_t col, PipesDirection direction);
+
+// ----------------------------------------------------------------------------
+// Takes back the last rotation, this counts as one move
+//
+// @param game    the game
+// @return        PIPES_OK or PIPES_ERROR_NOTHING
+//
+PipesError pipes_undo(PipesGame* game);
+
+// ----------------------------------------------------------------------------
+// Repeats the last rotation that was taken back, this counts as one move
+//
+// @param game    the game
+// @return        PIPES_OK or PIPES_ERROR_NOTHING
+//
+PipesError pipes_redo(PipesGame* game);
+
+// ----------------------------------------------------------------------------
+// Resets the map to the loaded one and the moves to 0
+//
+// @param game    the game
+//
+void pipes_restart(PipesGame* game);
+
+// ----------------------------------------------------------------------------
+// @param game    the game
+// @return        true if start- and dest-pipe are connected
+//
+bool pipes_is_connected(const PipesGame* game);
+
+// ----------------------------------------------------------------------------
+// @param game    the game
+// @return        moves since loading or the last restart, the score of a
+//                solved game
+//
+uint32_t pipes_score(const PipesGame* game);
+
+// ----------------------------------------------------------------------------
+// @param game    the game
+// @return        the maps width
+//
+uint32_t pipes_width(const PipesGame* game);
+
+// ----------------------------------------------------------------------------
+// @param game    the game
+// @return        the maps height
+//
+uint32_t pipes_height(const PipesGame* game);
+
+// ----------------------------------------------------------------------------
+// Gets a field in the format of the config file (see README.md)
+//
+// @param game    the game
+// @param row     row of the field, has to be inside of the map
+// @param col     column of the field, has to be inside of the map
+// @return        value of the field incl. its connections
+//
+uint8_t pipes_field(const PipesGame* game, uint32_t row, uint32_t col);
+
+// ----------------------------------------------------------------------------
+// Builds a config file of the current map, with the loaded highscores and
+// in the version of the loaded file
+//
+// @param game    the game
+// @param size    set to the size of the returned data
+// @return        the file contents to be freed with free, NULL if out of
+//                memory
+//
+uint8_t* pipes_serialize(const PipesGame* game, size_t* size);
+
+// ----------------------------------------------------------------------------
+// Finds rotations that connect start- and dest-pipe from the current map,
+// the game itself is not changed
+//
+// @param game      the game
+// @param moves     set to the rotations to be freed with free, NULL if there
+//                  are none
+// @param count     set to the number of rotations
+// @return          PIPES_OK, PIPES_ERROR_UNSOLVABLE or PIPES_ERROR_MEMORY
+//
+PipesError pipes_solve(const PipesGame* game, PipesMove** moves, size_t* count);
+
+#endif
@@ -0,0 +1,124 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include "framework.h"
+#include "render.h"
+
+// glyph ids use the open sides of a pipe (value & 0xAA), so the lowest bit
+// is free to mark the start and dest pipe
+#define RENDER_SPECIAL 0x01u
+
+#define ANSI_CLEAR_SCREEN "\033[H\033[2J"
+#define ANSI_MOVE_CURSOR  "\033[%u;%uH"
+#define ANSI_CLEAR_BELOW  "\033[J"
+
+// ----------------------------------------------------------------------------
+static uint8_t field_glyph(uint8_t** map, uint32_t row, uint32_t col, uint32_t start[2], uint32_t dest[2])
+{
+  uint8_t glyph = map[row][col] & 0xAAu;
+  if ((row == start[0] && col == start[1]) || (row == dest[0] && col == dest[1]))
+  {
+    glyph |= RENDER_SPECIAL;
+  }
+  return glyph;
+}
+
+// ----------------------------------------------------------------------------
+// Checks that every line of the frame fits on the terminal, otherwise the
+// cursor movements would land in the wrong place
+//
+static bool fits_on_screen(uint32_t width, uint32_t height)
+{
+  struct winsize size;
+  if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) != 0 || size.ws_row == 0)
+  {
+    return false;
+  }
+  uint32_t lines = getNumberOfDigits(width) + height + 4;
+  uint32_t columns = getNumberOfDigits(height) + 1 + width;
+  return lines < size.ws_row && columns <= size.ws_col;
+}
+
+// ----------------------------------------------------------------------------
+void render_init(Renderer* renderer, uint32_t width, uint32_t height)
+{
+  const char* mode = getenv(RENDER_DIFF_ENV);
+  const char* term = getenv("TERM");
+  renderer->width = width;
+  renderer->height = height;
+  renderer->drawn = false;
+  renderer->glyphs = NULL;
+  renderer->differential = mode != NULL && strcmp(mode, "1") == 0
+    && isatty(STDOUT_FILENO) && term != NULL && strcmp(term, "dumb") != 0
+    && fits_on_screen(width, height);
+  if (renderer->differential)
+  {
+    renderer->glyphs = (uint8_t*) malloc((size_t) width * height);
+    renderer->differential = renderer->glyphs != NULL;
+  }
+}
+
+// ----------------------------------------------------------------------------
+void render_free(Renderer* renderer)
+{
+  free(renderer->glyphs);
+  renderer->glyphs = NULL;
+}
+
+// ----------------------------------------------------------------------------
+void render_map(Renderer* renderer, uint8_t** map, uint32_t start[2], uint32_t dest[2])
+{
+  uint32_t width = renderer->width;
+  uint32_t height = renderer->height;
+  if (!renderer->differential)
+  {
+    printMap(map, width, height, start, dest);
+    return;
+  }
+
+  uint32_t first_line = getNumberOfDigits(width) + 3;
+  uint32_t first_column = getNumberOfDigits(height) + 2;
+  if (!renderer->drawn)
+  {
+    printf("%s", ANSI_CLEAR_SCREEN);
+    printMap(map, width, height, start, dest);
+    for (uint32_t row = 0; row < height; ++row)
+    {
+      for (uint32_t col = 0; col < width; ++col)
+      {
+        renderer->glyphs[(size_t) row * width + col] = field_glyph(map, row, col, start, dest);
+      }
+    }
+    renderer->drawn = true;
+    return;
+  }
+
+  for (uint32_t row = 0; row < height; ++row)
+  {
+    uint8_t* glyphs = &renderer->glyphs[(size_t) row * width];
+    for (uint32_t col = 0; col < width; ++col)
+    {
+      uint8_t glyph = field_glyph(map, row, col, start, dest);
+      if (glyph != glyphs[col])
+      {
+        glyphs[col] = glyph;
+        printf(ANSI_MOVE_CURSOR "%s", first_line + row, first_column + col,
+          (glyph & RENDER_SPECIAL) ? specialPipeToChar(glyph) : pipeToChar(glyph));
+      }
+    }
+  }
+
+  // the prompt and messages of the last turn are below the map
+  printf(ANSI_MOVE_CURSOR ANSI_CLEAR_BELOW "\n", first_line + height, 1u);
+}
+
+// ----------------------------------------------------------------------------
+void render_dirty(Renderer* renderer)
+{
+  renderer->drawn = false;
+}
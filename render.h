@@ -0,0 +1,63 @@
+#ifndef RENDER_H
+#define RENDER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// environment variable that turns on the differential redraw, e.g.
+// A3_DIFF_RENDER=1 ./a3 CONFIG_FILE
+#define RENDER_DIFF_ENV "A3_DIFF_RENDER"
+
+// ----------------------------------------------------------------------------
+// Redraws only the fields of the map that changed since the last frame
+//
+// The map is drawn once at the top of the screen. After that only the glyphs
+// that changed are written, using ANSI cursor movements, and the lines below
+// the map are cleared for the next prompt. If stdout is not a terminal, the
+// mode was not requested or the map does not fit on the screen, every frame
+// is printed with printMap instead.
+//
+typedef struct _Renderer_
+{
+  bool differential;
+  bool drawn;
+  uint32_t width;
+  uint32_t height;
+  uint8_t* glyphs;   // glyph of every field on screen, see field_glyph
+} Renderer;
+
+// ----------------------------------------------------------------------------
+// Sets up the renderer, checks the environment and the terminal
+//
+// @param renderer  the renderer
+// @param width     the maps width
+// @param height    the maps height
+//
+void render_init(Renderer* renderer, uint32_t width, uint32_t height);
+
+// ----------------------------------------------------------------------------
+// Frees the memory of the renderer
+//
+// @param renderer  the renderer
+//
+void render_free(Renderer* renderer);
+
+// ----------------------------------------------------------------------------
+// Prints the game map, see printMap
+//
+// @param renderer  the renderer
+// @param map       the game map
+// @param start     row and column of start pipe
+// @param dest      row and column of dest pipe
+//
+void render_map(Renderer* renderer, uint8_t** map, uint32_t start[2], uint32_t dest[2]);
+
+// ----------------------------------------------------------------------------
+// Makes the next frame redraw the whole map, must be called after anything
+// but the prompt was printed, as that may have scrolled the map
+//
+// @param renderer  the renderer
+//
+void render_dirty(Renderer* renderer);
+
+#endif
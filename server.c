@@ -0,0 +1,904 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "framework.h"
+#include "game.h"
+#include "highscore.h"
+#include "server.h"
+#include "solver.h"
+
+#define ERROR_SOCKET "Error: Cannot open socket: %s\n"
+
+// the stats are kept per process, so a session does not offer them
+#define SERVER_HELP_TEXT HELP_TEXT_HEAD HELP_TEXT_TAIL
+
+#define SERVER_STOP_CHECK_MS 500
+
+// the search of solve looks at no more than this many branches divided by
+// the fields of the map, as every branch walks the map once
+#define SERVER_SOLVE_BUDGET ((size_t) 1 << 22)
+#define ERROR_SOLVE_TIMEOUT "Error: No solution found in time\n"
+
+// the pipes every worker polls before its sessions
+#define WORKER_PIPES 2
+
+// ----------------------------------------------------------------------------
+// The levels the sessions play and their highscores
+//
+// The highscores of a level are opened when a session first solves it and
+// then shared by all sessions.
+//
+typedef struct _Campaign_
+{
+  const char* config;
+  const LevelPack* pack;
+  pthread_mutex_t lock;       // guards <highscores>
+  Highscores** highscores;    // of every level, NULL until needed
+} Campaign;
+
+// ----------------------------------------------------------------------------
+// One connected client
+//
+// <input> holds the bytes received after the last complete line. <output>
+// is sent before the next line is handled, a session marked as <closing> is
+// closed once its output was sent. A session is <naming> after it beat a
+// highscore, until a valid name was sent.
+//
+// A session is <busy> while a thread of its own does <work> that may take
+// long, like solve or adding a highscore. That thread writes the session to
+// <done_fd> when it is done, then the worker calls <finish>; until then the
+// worker leaves the session alone.
+//
+typedef struct _Session_
+{
+  int fd;
+  Game game;
+  uint32_t index;             // of the level in the pack
+  Campaign* campaign;
+  Highscores* highscores;     // of the level, set once it is solved
+  bool naming;
+  bool busy;
+  int done_fd;
+  void (*work)(struct _Session_*);
+  void (*finish)(struct _Session_*);
+  SolverResult solved;
+  Solution solution;
+  char name[HIGHSCORE_NAME_SIZE];
+  char input[SERVER_LINE_MAX];
+  size_t input_size;
+  char* output;
+  size_t output_size;
+  size_t output_sent;
+  size_t output_capacity;
+  bool closing;
+} Session;
+
+// ----------------------------------------------------------------------------
+// A thread and the sessions it serves
+//
+// The listener writes the descriptors of new connections into <notify>,
+// the threads of busy sessions write them into <done>. <polls>[0] and
+// <polls>[1] wait for the pipes, <polls>[i + WORKER_PIPES] for
+// <sessions>[i].
+//
+typedef struct _Worker_
+{
+  pthread_t thread;
+  int notify[2];
+  int done[2];
+  Campaign* campaign;
+  Session** sessions;
+  struct pollfd* polls;
+  size_t count;
+  size_t capacity;
+} Worker;
+
+static volatile sig_atomic_t stop_server = 0;
+
+// ----------------------------------------------------------------------------
+static void handle_stop(int signal)
+{
+  (void) signal;
+  stop_server = 1;
+}
+
+// ----------------------------------------------------------------------------
+// @return  the highscores of a level, NULL if out of memory or if the level
+//          is invalid
+//
+static Highscores* campaign_highscores(Campaign* campaign, uint32_t index)
+{
+  pthread_mutex_lock(&campaign->lock);
+  Highscores* highscores = campaign->highscores[index];
+  Level level;
+  if (highscores == NULL && level_pack_get(campaign->pack, index, &level) == LEVEL_OK)
+  {
+    highscores = (Highscores*) malloc(sizeof(Highscores));
+    uint32_t number = campaign->pack->indexed ? index + 1 : 0;
+    if (highscores != NULL && !highscores_open(highscores, campaign->config, number, &level))
+    {
+      free(highscores);
+      highscores = NULL;
+    }
+    campaign->highscores[index] = highscores;
+    level_close(&level);
+  }
+  pthread_mutex_unlock(&campaign->lock);
+  return highscores;
+}
+
+// ----------------------------------------------------------------------------
+// Adds text to the output of a session
+//
+// @return  false if out of memory
+//
+static bool session_write(Session* session, const char* text, size_t length)
+{
+  if (session->output_size + length > session->output_capacity)
+  {
+    size_t capacity = session->output_size + length;
+    char* output = (char*) realloc(session->output, capacity);
+    if (output == NULL)
+    {
+      session->closing = true;
+      return false;
+    }
+    session->output = output;
+    session->output_capacity = capacity;
+  }
+  memcpy(session->output + session->output_size, text, length);
+  session->output_size += length;
+  return true;
+}
+
+// ----------------------------------------------------------------------------
+// printf into the output of a session, for the short messages of framework.h
+//
+static void session_printf(Session* session, const char* format, ...)
+{
+  char text[SERVER_LINE_MAX + 64];
+  va_list arguments;
+  va_start(arguments, format);
+  int length = vsnprintf(text, sizeof(text), format, arguments);
+  va_end(arguments);
+  if (length > 0)
+  {
+    session_write(session, text, ((size_t) length < sizeof(text)) ? (size_t) length : sizeof(text) - 1);
+  }
+}
+
+// ----------------------------------------------------------------------------
+// The thread of a busy session, see Session
+//
+static void* session_run(void* argument)
+{
+  Session* session = (Session*) argument;
+  session->work(session);
+  while (write(session->done_fd, &session, sizeof(session)) < 0 && errno == EINTR)
+  {
+  }
+  return NULL;
+}
+
+// ----------------------------------------------------------------------------
+// Does work that may take long on a thread of its own, so the other sessions
+// of the worker do not wait for it; if no thread can be started, the work is
+// done right away
+//
+// @param work    done on the thread, must not touch the output
+// @param finish  called by the worker once <work> is done
+//
+static void session_start(Session* session, void (*work)(Session*), void (*finish)(Session*))
+{
+  pthread_t thread;
+  session->work = work;
+  session->finish = finish;
+  session->busy = true;
+  if (pthread_create(&thread, NULL, session_run, session) == 0)
+  {
+    pthread_detach(thread);
+    return;
+  }
+  session->busy = false;
+  work(session);
+  finish(session);
+}
+
+// ----------------------------------------------------------------------------
+// Sends the highscore table from memory and ends the session
+//
+static void session_highscores(Session* session)
+{
+  HighscoreEntry entries[UINT8_MAX];
+  size_t count = highscores_top(session->highscores, entries, UINT8_MAX);
+  session_printf(session, "%s", INFO_HIGHSCORE_HEADER);
+  for (size_t i = 0; i < count; i++)
+  {
+    char name[HIGHSCORE_NAME_SIZE + 1] = { 0 };
+    memcpy(name, entries[i].name, HIGHSCORE_NAME_SIZE);
+    session_printf(session, INFO_HIGHSCORE_ENTRY, name, entries[i].score);
+  }
+  session->closing = true;
+}
+
+// ----------------------------------------------------------------------------
+// Adds the score of a solved session under <name>, on its own thread
+//
+static void session_add(Session* session)
+{
+  highscores_add(session->highscores, (uint32_t) (session->game.turn - 1), session->name);
+}
+
+// ----------------------------------------------------------------------------
+// Takes the name for a beaten highscore, like read_name in a3.c
+//
+static void session_name(Session* session, char* line)
+{
+  char* name = line + strspn(line, " \t");
+  name[strcspn(name, " \t\r\n")] = '\0';
+  if (strlen(name) != HIGHSCORE_NAME_SIZE)
+  {
+    session_printf(session, "%s%s", ERROR_NAME_LENGTH, INPUT_NAME);
+    return;
+  }
+  for (size_t i = 0; i < HIGHSCORE_NAME_SIZE; i++)
+  {
+    if (!((name[i] >= 'a' && name[i] <= 'z') || (name[i] >= 'A' && name[i] <= 'Z')))
+    {
+      session_printf(session, "%s%s", ERROR_NAME_ALPHABETIC, INPUT_NAME);
+      return;
+    }
+    name[i] = (char) ((name[i] >= 'a') ? name[i] - 'a' + 'A' : name[i]);
+  }
+  session->naming = false;
+  memcpy(session->name, name, HIGHSCORE_NAME_SIZE);
+  // waits for the lock of the log and syncs it to the disk
+  session_start(session, session_add, session_highscores);
+}
+
+// ----------------------------------------------------------------------------
+// Sends the map and either the result or the prompt of the next turn
+//
+static void session_turn(Session* session)
+{
+  Game* game = &session->game;
+  size_t length = 0;
+  const char* frame = formatMap(game->grid.rows, game->grid.width, game->grid.height, game->start, game->dest, &length);
+  if (frame == NULL || !session_write(session, frame, length))
+  {
+    session->closing = true;
+    return;
+  }
+  if (game_is_solved(game))
+  {
+    session->highscores = campaign_highscores(session->campaign, session->index);
+    if (session->highscores == NULL)
+    {
+      session_printf(session, "%s", ERROR_OUT_OF_MEMORY);
+      session->closing = true;
+      return;
+    }
+    session_printf(session, "%s", INFO_PUZZLE_SOLVED);
+    session_printf(session, INFO_SCORE, (unsigned) (game->turn - 1));
+    if (highscores_qualifies(session->highscores, (uint32_t) (game->turn - 1)))
+    {
+      session_printf(session, "%s%s", INFO_BEAT_HIGHSCORE, INPUT_NAME);
+      session->naming = true;
+      return;
+    }
+    session_highscores(session);
+    return;
+  }
+  session_printf(session, INPUT_PROMPT, (unsigned) game->turn);
+}
+
+// ----------------------------------------------------------------------------
+// Checks a parsed command like is_input_valid and read_command do
+//
+// @return  false if an error was written to the session
+//
+static bool session_check(Session* session, Command cmmd, uint32_t row, uint32_t col)
+{
+  const Game* game = &session->game;
+  if (cmmd == ROTATE)
+  {
+    if ((row == game->start[0] + 1 && col == game->start[1] + 1) || (row == game->dest[0] + 1 && col == game->dest[1] + 1))
+    {
+      session_printf(session, "%s", ERROR_ROTATE_INVALID);
+      return false;
+    }
+    if (row > game->grid.height || col > game->grid.width)
+    {
+      session_printf(session, "%s", USAGE_COMMAND_ROTATE);
+      return false;
+    }
+  }
+  if (cmmd == UNDO && !game_can_undo(game))
+  {
+    session_printf(session, "%s", ERROR_NOTHING_TO_UNDO);
+    return false;
+  }
+  if (cmmd == REDO && !game_can_redo(game))
+  {
+    session_printf(session, "%s", ERROR_NOTHING_TO_REDO);
+    return false;
+  }
+  return true;
+}
+
+// ----------------------------------------------------------------------------
+// Looks for rotations that connect the pipes of a session, within
+// SERVER_SOLVE_BUDGET
+//
+static void session_find(Session* session)
+{
+  size_t budget = SERVER_SOLVE_BUDGET / grid_size(&session->game.grid) + 1;
+  session->solved = solver_solve_limited(&session->game, false, budget, &session->solution);
+}
+
+// ----------------------------------------------------------------------------
+// Sends the rotations session_find found and the prompt, like
+// print_solution in a3.c
+//
+static void session_solution(Session* session)
+{
+  Solution* solution = &session->solution;
+  switch (session->solved)
+  {
+    case SOLVER_OK:
+      session_printf(session, INFO_SOLUTION, solution->count);
+      break;
+    case SOLVER_LIMIT:
+      session_printf(session, "%s", ERROR_SOLVE_TIMEOUT);
+      break;
+    case SOLVER_UNSOLVABLE:
+      session_printf(session, "%s", ERROR_NO_SOLUTION);
+      break;
+    case SOLVER_MEMORY:
+      session_printf(session, "%s", ERROR_OUT_OF_MEMORY);
+      break;
+  }
+  uint32_t width = session->game.grid.width;
+  for (size_t i = 0; session->solved == SOLVER_OK && i < solution->count && !session->closing; i++)
+  {
+    Move* move = &solution->moves[i];
+    session_printf(session, INFO_SOLUTION_MOVE, (move->direction == 3) ? "right" : "left",
+      move->field / width + 1, move->field % width + 1);
+  }
+  solution_free(solution);
+  session_printf(session, INPUT_PROMPT, (unsigned) session->game.turn);
+}
+
+// ----------------------------------------------------------------------------
+// Starts another level of the pack, like switch_level in a3.c
+//
+// @return  false if the level was not started and an error was written to
+//          the session
+//
+static bool session_level(Session* session, uint32_t number)
+{
+  Level level;
+  Game game;
+  if (number > session->campaign->pack->count)
+  {
+    session_printf(session, ERROR_LEVEL_MISSING, number);
+    return false;
+  }
+  switch (level_pack_get(session->campaign->pack, number - 1, &level))
+  {
+    case LEVEL_OK:
+      break;
+    case LEVEL_ERROR_MEMORY:
+      session_printf(session, "%s", ERROR_OUT_OF_MEMORY);
+      return false;
+    default:
+      session_printf(session, ERROR_LEVEL_INVALID, number);
+      return false;
+  }
+  bool started = game_init(&game, &level);
+  level_close(&level);
+  if (!started)
+  {
+    session_printf(session, "%s", ERROR_OUT_OF_MEMORY);
+    return false;
+  }
+  game_free(&session->game);
+  session->game = game;
+  session->index = number - 1;
+  return true;
+}
+
+// ----------------------------------------------------------------------------
+// Handles one line of a session, like one turn of the interactive game
+//
+static void session_command(Session* session, char* line)
+{
+  Command cmmd = NONE;
+  size_t direction = 0;
+  uint32_t row = 0;
+  uint32_t col = 0;
+  if (session->naming)
+  {
+    session_name(session, line);
+    return;
+  }
+  char* error = parseCommand(line, &cmmd, &direction, &row, &col);
+  if (error == (char*) 1)
+  {
+    session_printf(session, "%s", (cmmd == LEVEL) ? USAGE_COMMAND_LEVEL : USAGE_COMMAND_ROTATE);
+  }
+  else if (error != NULL || cmmd == STATS)
+  {
+    // the stats are kept per process, not per session
+    session_printf(session, ERROR_UNKNOWN_COMMAND, (error != NULL) ? error : "stats");
+  }
+  else if (cmmd == QUIT)
+  {
+    session->closing = true;
+    return;
+  }
+  else if (cmmd == SOLVE)
+  {
+    // the prompt follows the solution
+    session_start(session, session_find, session_solution);
+    return;
+  }
+  else if (cmmd == LEVEL)
+  {
+    if (session_level(session, row))
+    {
+      session_turn(session);
+      return;
+    }
+  }
+  else if (cmmd != NONE && session_check(session, cmmd, row, col))
+  {
+    if (cmmd == HELP)
+    {
+      // longer than session_printf takes
+      session_write(session, SERVER_HELP_TEXT, strlen(SERVER_HELP_TEXT));
+    }
+    if (!game_apply(&session->game, cmmd, direction, row, col))
+    {
+      session_printf(session, "%s", ERROR_OUT_OF_MEMORY);
+      session->closing = true;
+      return;
+    }
+    game_end_turn(&session->game);
+    session_turn(session);
+    return;
+  }
+  session_printf(session, INPUT_PROMPT, (unsigned) session->game.turn);
+}
+
+// ----------------------------------------------------------------------------
+// @return  true if the next line can be handled, the output of the last one
+//          was sent
+//
+static bool session_has_line(Session* session)
+{
+  if (session->closing || session->busy || session->output_sent < session->output_size)
+  {
+    return false;
+  }
+  if (memchr(session->input, '\n', session->input_size) == NULL)
+  {
+    // a line that does not fit is not a command of the game
+    session->closing = session->input_size == SERVER_LINE_MAX;
+    return false;
+  }
+  return true;
+}
+
+// ----------------------------------------------------------------------------
+// Handles the next line of the input, see session_has_line
+//
+static void session_handle_line(Session* session)
+{
+  char* end = memchr(session->input, '\n', session->input_size);
+  session->output_size = 0;
+  session->output_sent = 0;
+
+  char line[SERVER_LINE_MAX + 1];
+  size_t length = (size_t) (end - session->input) + 1;
+  memcpy(line, session->input, length);
+  line[length] = '\0';
+  session->input_size -= length;
+  memmove(session->input, session->input + length, session->input_size);
+  session_command(session, line);
+}
+
+// ----------------------------------------------------------------------------
+// Starts a session with the first level of the pack
+//
+static Session* session_open(int fd, int done_fd, Campaign* campaign)
+{
+  Level level;
+  Session* session = (Session*) calloc(1, sizeof(Session));
+  if (session == NULL || level_pack_get(campaign->pack, 0, &level) != LEVEL_OK)
+  {
+    free(session);
+    return NULL;
+  }
+  bool started = game_init(&session->game, &level);
+  level_close(&level);
+  if (!started)
+  {
+    free(session);
+    return NULL;
+  }
+  session->fd = fd;
+  session->done_fd = done_fd;
+  session->campaign = campaign;
+  session_turn(session);
+  return session;
+}
+
+// ----------------------------------------------------------------------------
+static void session_close(Session* session)
+{
+  close(session->fd);
+  game_free(&session->game);
+  solution_free(&session->solution);
+  free(session->output);
+  free(session);
+}
+
+// ----------------------------------------------------------------------------
+// Sends as much of the output as the socket takes
+//
+// @return  false if the connection is gone
+//
+static bool session_send(Session* session)
+{
+  while (session->output_sent < session->output_size)
+  {
+    ssize_t sent = send(session->fd, session->output + session->output_sent,
+      session->output_size - session->output_sent, MSG_NOSIGNAL);
+    if (sent < 0)
+    {
+      return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+    }
+    session->output_sent += (size_t) sent;
+  }
+  return true;
+}
+
+// ----------------------------------------------------------------------------
+// Reads what the client sent
+//
+// @return  false if the connection is gone
+//
+static bool session_receive(Session* session)
+{
+  ssize_t got = recv(session->fd, session->input + session->input_size, SERVER_LINE_MAX - session->input_size, 0);
+  if (got == 0)
+  {
+    return false;
+  }
+  if (got < 0)
+  {
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+  }
+  session->input_size += (size_t) got;
+  return true;
+}
+
+// ----------------------------------------------------------------------------
+static bool worker_add(Worker* worker, int fd)
+{
+  if (worker->count == worker->capacity)
+  {
+    size_t capacity = (worker->capacity == 0) ? 64 : worker->capacity * 2;
+    Session** sessions = (Session**) realloc(worker->sessions, capacity * sizeof(Session*));
+    if (sessions == NULL)
+    {
+      return false;
+    }
+    worker->sessions = sessions;
+    struct pollfd* polls = (struct pollfd*) realloc(worker->polls, (capacity + WORKER_PIPES) * sizeof(struct pollfd));
+    if (polls == NULL)
+    {
+      return false;
+    }
+    worker->polls = polls;
+    worker->capacity = capacity;
+  }
+  Session* session = session_open(fd, worker->done[1], worker->campaign);
+  if (session == NULL)
+  {
+    return false;
+  }
+  worker->sessions[worker->count++] = session;
+  return true;
+}
+
+// ----------------------------------------------------------------------------
+// Takes the new connections from the listener
+//
+// @return  false once the listener closed the pipe
+//
+static bool worker_accept(Worker* worker)
+{
+  int fds[64];
+  ssize_t got = read(worker->notify[0], fds, sizeof(fds));
+  if (got <= 0)
+  {
+    return got < 0 && errno == EINTR;
+  }
+  for (size_t i = 0; i < (size_t) got / sizeof(int); i++)
+  {
+    if (!worker_add(worker, fds[i]))
+    {
+      close(fds[i]);
+    }
+  }
+  return true;
+}
+
+// ----------------------------------------------------------------------------
+// Finishes the sessions whose work is done, waits for the pipe if none is
+// done yet
+//
+// @return  number of sessions taken, 0 if the pipe failed
+//
+static size_t worker_done(Worker* worker)
+{
+  Session* sessions[64];
+  ssize_t got;
+  do
+  {
+    got = read(worker->done[0], sessions, sizeof(sessions));
+  } while (got < 0 && errno == EINTR);
+  size_t count = (got > 0) ? (size_t) got / sizeof(Session*) : 0;
+  for (size_t i = 0; i < count; i++)
+  {
+    sessions[i]->busy = false;
+    sessions[i]->finish(sessions[i]);
+  }
+  return count;
+}
+
+// ----------------------------------------------------------------------------
+static void* worker_run(void* argument)
+{
+  Worker* worker = (Worker*) argument;
+  worker->polls = (struct pollfd*) malloc(WORKER_PIPES * sizeof(struct pollfd));
+  bool running = worker->polls != NULL;
+  while (running)
+  {
+    worker->polls[0].fd = worker->notify[0];
+    worker->polls[0].events = POLLIN;
+    worker->polls[1].fd = worker->done[0];
+    worker->polls[1].events = POLLIN;
+    for (size_t i = 0; i < worker->count; i++)
+    {
+      // a session is not polled while it is busy
+      Session* session = worker->sessions[i];
+      worker->polls[i + WORKER_PIPES].fd = session->busy ? -1 : session->fd;
+      worker->polls[i + WORKER_PIPES].events = (session->output_sent < session->output_size) ? POLLOUT
+        : (session->input_size < SERVER_LINE_MAX) ? POLLIN : 0;
+    }
+    if (poll(worker->polls, worker->count + WORKER_PIPES, -1) < 0)
+    {
+      running = errno == EINTR;
+      continue;
+    }
+    if (worker->polls[1].revents & POLLIN)
+    {
+      worker_done(worker);
+    }
+
+    for (size_t i = 0; i < worker->count; i++)
+    {
+      Session* session = worker->sessions[i];
+      short events = worker->polls[i + WORKER_PIPES].revents;
+      bool alive = true;
+      if (events & (POLLIN | POLLHUP | POLLERR) && !(events & POLLOUT))
+      {
+        alive = session_receive(session);
+      }
+      else if (!session->busy)
+      {
+        // also sends the output of work that was just finished
+        alive = session_send(session);
+      }
+      // lines that came in together are handled one after the other, as long
+      // as the socket takes the output
+      while (alive && session_has_line(session))
+      {
+        session_handle_line(session);
+        alive = session_send(session);
+      }
+      if (!session->busy && (!alive || (session->closing && session->output_sent == session->output_size)))
+      {
+        session_close(session);
+        // the last session takes the free slot, poll reports its events again
+        // in the next round
+        worker->sessions[i] = worker->sessions[--worker->count];
+        worker->polls[i + WORKER_PIPES] = worker->polls[worker->count + WORKER_PIPES];
+        worker->polls[i + WORKER_PIPES].revents = 0;
+        i--;
+      }
+    }
+    if (worker->polls[0].revents & (POLLIN | POLLHUP))
+    {
+      running = worker_accept(worker);
+    }
+  }
+
+  // the sessions can only be closed once their work is done
+  size_t busy = 0;
+  for (size_t i = 0; i < worker->count; i++)
+  {
+    busy += worker->sessions[i]->busy ? 1 : 0;
+  }
+  while (busy > 0)
+  {
+    size_t taken = worker_done(worker);
+    if (taken == 0)
+    {
+      break;
+    }
+    busy -= taken;
+  }
+  for (size_t i = 0; i < worker->count; i++)
+  {
+    session_close(worker->sessions[i]);
+  }
+  free(worker->sessions);
+  free(worker->polls);
+  freeThreadScratch();
+  return NULL;
+}
+
+// ----------------------------------------------------------------------------
+static int open_socket(const char* path)
+{
+  struct sockaddr_un address;
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if (strlen(path) >= sizeof(address.sun_path))
+  {
+    return -1;
+  }
+  strcpy(address.sun_path, path);
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0)
+  {
+    return -1;
+  }
+  unlink(path);
+  if (bind(fd, (struct sockaddr*) &address, sizeof(address)) != 0 || listen(fd, SOMAXCONN) != 0)
+  {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+// ----------------------------------------------------------------------------
+static void campaign_close(Campaign* campaign)
+{
+  for (uint32_t i = 0; campaign->highscores != NULL && i < campaign->pack->count; i++)
+  {
+    if (campaign->highscores[i] != NULL)
+    {
+      highscores_close(campaign->highscores[i]);
+      free(campaign->highscores[i]);
+    }
+  }
+  free(campaign->highscores);
+  pthread_mutex_destroy(&campaign->lock);
+}
+
+// ----------------------------------------------------------------------------
+int run_server(const char* path, const char* config, const LevelPack* pack)
+{
+  Campaign campaign = { config, pack, PTHREAD_MUTEX_INITIALIZER, NULL };
+  campaign.highscores = (Highscores**) calloc(pack->count, sizeof(Highscores*));
+  if (campaign.highscores == NULL)
+  {
+    printf("%s", ERROR_OUT_OF_MEMORY);
+    campaign_close(&campaign);
+    return 4;
+  }
+  int listener = open_socket(path);
+  if (listener < 0)
+  {
+    printf(ERROR_SOCKET, path);
+    campaign_close(&campaign);
+    return 2;
+  }
+
+  // only the listener gets the signals, so accept is interrupted by them
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = handle_stop;
+  sigemptyset(&action.sa_mask);
+  sigaction(SIGINT, &action, NULL);
+  sigaction(SIGTERM, &action, NULL);
+  sigset_t signals;
+  sigset_t previous;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &signals, &previous);
+
+  Worker workers[SERVER_WORKERS];
+  size_t started = 0;
+  for (; started < SERVER_WORKERS; started++)
+  {
+    Worker* worker = &workers[started];
+    memset(worker, 0, sizeof(Worker));
+    worker->campaign = &campaign;
+    if (pipe(worker->notify) != 0)
+    {
+      break;
+    }
+    if (pipe(worker->done) != 0)
+    {
+      close(worker->notify[0]);
+      close(worker->notify[1]);
+      break;
+    }
+    if (pthread_create(&worker->thread, NULL, worker_run, worker) != 0)
+    {
+      close(worker->notify[0]);
+      close(worker->notify[1]);
+      close(worker->done[0]);
+      close(worker->done[1]);
+      break;
+    }
+  }
+  pthread_sigmask(SIG_SETMASK, &previous, NULL);
+
+  // poll wakes up now and then, in case a signal came in between the check
+  // of <stop_server> and the call
+  struct pollfd waiting = { .fd = listener, .events = POLLIN, .revents = 0 };
+  size_t next = 0;
+  while (started > 0 && !stop_server)
+  {
+    if (poll(&waiting, 1, SERVER_STOP_CHECK_MS) <= 0)
+    {
+      continue;
+    }
+    int fd = accept(listener, NULL, NULL);
+    if (fd < 0)
+    {
+      continue;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    if (write(workers[next].notify[1], &fd, sizeof(fd)) != sizeof(fd))
+    {
+      close(fd);
+    }
+    next = (next + 1) % started;
+  }
+
+  // closing the pipes ends the workers
+  for (size_t i = 0; i < started; i++)
+  {
+    close(workers[i].notify[1]);
+    pthread_join(workers[i].thread, NULL);
+    close(workers[i].notify[0]);
+    close(workers[i].done[0]);
+    close(workers[i].done[1]);
+  }
+  close(listener);
+  unlink(path);
+  campaign_close(&campaign);
+  return (started > 0) ? 0 : 4;
+}
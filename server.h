@@ -0,0 +1,35 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include "level.h"
+
+// number of threads that serve the sessions
+#define SERVER_WORKERS 4
+
+// longest command line a client can send, longer lines end the session
+#define SERVER_LINE_MAX 256
+
+// ----------------------------------------------------------------------------
+// Serves the games of a level pack to many clients over a Unix domain socket
+//
+// Every connection is a session with its own game, using the same commands
+// and output as the interactive game. It starts with the first level and
+// can switch with the level command. The sessions are spread over
+// SERVER_WORKERS threads that each wait for all of their sessions with
+// poll. A session only reads its next command once the output of the last
+// one was sent, so it never holds more than one line of input and one
+// frame of output. A solved session gets the score, is asked for a name if
+// it beat a highscore, gets the highscore table and is closed. The
+// highscores of a level are shared by all sessions and kept next to the
+// pack, see highscore.h.
+//
+// Runs until SIGINT or SIGTERM is received.
+//
+// @param path    path of the socket, an existing socket file is replaced
+// @param config  path of the config file or level pack
+// @param pack    the levels the sessions play, has to stay open
+// @return        exit code of the program
+//
+int run_server(const char* path, const char* config, const LevelPack* pack);
+
+#endif
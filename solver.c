@@ -0,0 +1,1402 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "solver.h"
+
+#define SIDES 4
+#define DOMAINS 16
+#define ALL_ORIENTATIONS 0xF
+#define NO_PAIR 255
+#define NO_STATE SIZE_MAX
+#define NO_BRANCH SIZE_MAX
+#define UNREACHABLE UINT32_MAX
+
+// the sides of a pipe in the order of their opening bits
+static const uint8_t SIDE_BIT[SIDES] = { 0x80, 0x20, 0x08, 0x02 };   // top, left, bottom, right
+
+// ----------------------------------------------------------------------------
+// How a pipe with the openings <n> (bit i for side i) can be rotated
+//
+// <rotated> are the openings after 0 to 3 right rotations. A domain is a set
+// of these orientations, bit k for k right rotations. <moves> is the fewest
+// rotations to an orientation of the domain that opens both sides, NO_PAIR if
+// there is none. 3 right rotations are done as one rotation to the left.
+//
+typedef struct _Turns_
+{
+  uint8_t rotated[16][SIDES];
+  uint8_t moves[16][DOMAINS][SIDES][SIDES];
+} Turns;
+
+// ----------------------------------------------------------------------------
+// A growable stack of fields, states or branches
+//
+typedef struct _Stack_
+{
+  size_t* items;
+  size_t size;
+  size_t capacity;
+} Stack;
+
+// ----------------------------------------------------------------------------
+// A node of the search tree, limiting one pipe to some of its orientations
+// on top of the limits of its parent
+//
+// <bound> is the fewest rotations a path of the branch can need.
+//
+typedef struct _Branch_
+{
+  size_t parent;
+  size_t field;
+  uint8_t domain;
+  uint32_t depth;
+  uint32_t bound;
+} Branch;
+
+// ----------------------------------------------------------------------------
+// A state is a field and the side it is entered from, field * SIDES + side
+//
+typedef struct _Search_
+{
+  const Game* game;
+  uint32_t width;
+  uint32_t height;
+  size_t start;
+  size_t dest;
+  Turns turns;
+  uint8_t* openings;    // openings of every field as loaded
+  uint8_t* domains;     // orientations every field is limited to
+  uint8_t* usable;      // sides of every field that can be part of a path
+  uint8_t* used;        // sides of every field used by the current walk
+  uint32_t* remaining;  // fewest rotations from a state to the dest-pipe
+  uint32_t* distance;   // fewest rotations from the start-pipe to a state
+  size_t* previous;     // state before a state on the walk with <distance>
+  uint32_t* visited;    // <distance> and <previous> are set if this is <walks>
+  uint32_t walks;
+  Stack* buckets;       // states by number of rotations, see queue_push
+  size_t bucket_count;
+  Stack walk;
+  Branch* branches;
+  size_t branch_count;
+  size_t branch_capacity;
+  Stack open;           // heap of the branches that were not looked at yet
+  bool fewest;
+  size_t budget;        // branches search_branches looks at, 0 for no limit
+  atomic_bool* stop;    // ends find_walk early once set, NULL if never
+} Search;
+
+// ----------------------------------------------------------------------------
+static inline uint8_t opposite(uint8_t side)
+{
+  return (uint8_t) ((side + 2) % SIDES);
+}
+
+// ----------------------------------------------------------------------------
+static inline uint8_t openings_of(uint8_t value)
+{
+  uint8_t openings = 0;
+  for (uint8_t side = 0; side < SIDES; side++)
+  {
+    if (value & SIDE_BIT[side])
+    {
+      openings |= (uint8_t) (1u << side);
+    }
+  }
+  return openings;
+}
+
+// ----------------------------------------------------------------------------
+// @return  false if <side> of <field> is the border of the map
+//
+static bool neighbour(const Search* search, size_t field, uint8_t side, size_t* next)
+{
+  size_t row = field / search->width;
+  size_t col = field % search->width;
+  switch (side)
+  {
+    case 0:
+      *next = field - search->width;
+      return row > 0;
+    case 1:
+      *next = field - 1;
+      return col > 0;
+    case 2:
+      *next = field + search->width;
+      return row + 1 < search->height;
+    default:
+      *next = field + 1;
+      return col + 1 < search->width;
+  }
+}
+
+// ----------------------------------------------------------------------------
+static bool stack_push(Stack* stack, size_t item)
+{
+  if (stack->size == stack->capacity)
+  {
+    size_t capacity = (stack->capacity == 0) ? 256 : stack->capacity * 2;
+    size_t* items = (size_t*) realloc(stack->items, capacity * sizeof(size_t));
+    if (items == NULL)
+    {
+      return false;
+    }
+    stack->items = items;
+    stack->capacity = capacity;
+  }
+  stack->items[stack->size++] = item;
+  return true;
+}
+
+// ----------------------------------------------------------------------------
+// Tries every rotation of every pipe with rotate_pipe, so the solver turns
+// the pipes exactly like the rotate command
+//
+static void build_turns(Turns* turns)
+{
+  memset(turns->moves, NO_PAIR, sizeof(turns->moves));
+  for (uint8_t n = 0; n < 16; n++)
+  {
+    uint8_t value = 0;
+    for (uint8_t side = 0; side < SIDES; side++)
+    {
+      value |= (n & (1u << side)) ? SIDE_BIT[side] : 0;
+    }
+    for (uint8_t rights = 0; rights < SIDES; rights++)
+    {
+      turns->rotated[n][rights] = openings_of(value);
+      value = rotate_pipe(value, 3);
+    }
+    for (uint8_t domain = 0; domain < DOMAINS; domain++)
+    {
+      for (uint8_t rights = 0; rights < SIDES; rights++)
+      {
+        uint8_t moves = (rights == 3) ? 1 : rights;
+        uint8_t openings = turns->rotated[n][rights];
+        for (uint8_t in = 0; in < SIDES && (domain & (1u << rights)); in++)
+        {
+          for (uint8_t out = 0; out < SIDES; out++)
+          {
+            if (in != out && (openings & (1u << in)) && (openings & (1u << out))
+              && moves < turns->moves[n][domain][in][out])
+            {
+              turns->moves[n][domain][in][out] = moves;
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+// ----------------------------------------------------------------------------
+// @param rights  set to the right rotations of the orientation
+// @return        the fewest rotations of the field to an orientation of its
+//                domain that opens all of <sides>, NO_PAIR if there is none
+//
+static uint8_t rotations_for(const Search* search, size_t field, uint8_t sides, uint8_t* rights)
+{
+  uint8_t best = NO_PAIR;
+  for (uint8_t k = 0; k < SIDES; k++)
+  {
+    uint8_t moves = (k == 3) ? 1 : k;
+    if ((search->domains[field] & (1u << k)) && (search->turns.rotated[search->openings[field]][k] & sides) == sides
+      && moves < best)
+    {
+      best = moves;
+      *rights = k;
+    }
+  }
+  return best;
+}
+
+// ----------------------------------------------------------------------------
+// @return  true if the field is the start- or dest-pipe, those can not be
+//          rotated and are only left or entered
+//
+static inline bool is_end(const Search* search, size_t field)
+{
+  return field == search->start || field == search->dest;
+}
+
+// ----------------------------------------------------------------------------
+// @return  the sides some orientation of the domain of the field opens
+//
+static uint8_t possible_sides(const Search* search, size_t field)
+{
+  uint8_t sides = 0;
+  for (uint8_t k = 0; k < SIDES; k++)
+  {
+    if (search->domains[field] & (1u << k))
+    {
+      sides |= search->turns.rotated[search->openings[field]][k];
+    }
+  }
+  return sides;
+}
+
+// ----------------------------------------------------------------------------
+// Removes the usable sides of a field that no orientation combines with
+// another usable side, and the matching sides of its neighbours
+//
+static bool prune_field(Search* search, size_t field, Stack* pending, uint8_t* queued)
+{
+  uint8_t usable = search->usable[field];
+  uint8_t kept = usable;
+  if (!is_end(search, field))
+  {
+    kept = 0;
+    for (uint8_t in = 0; in < SIDES; in++)
+    {
+      for (uint8_t out = 0; out < SIDES; out++)
+      {
+        if ((usable & (1u << in)) && (usable & (1u << out))
+          && search->turns.moves[search->openings[field]][search->domains[field]][in][out] != NO_PAIR)
+        {
+          kept |= (uint8_t) (1u << in);
+        }
+      }
+    }
+  }
+  search->usable[field] = kept;
+
+  for (uint8_t side = 0; side < SIDES; side++)
+  {
+    size_t next = 0;
+    if ((usable & ~kept & (1u << side)) && neighbour(search, field, side, &next))
+    {
+      search->usable[next] &= (uint8_t) ~(1u << opposite(side));
+      if (!queued[next])
+      {
+        queued[next] = 1;
+        if (!stack_push(pending, next))
+        {
+          return false;
+        }
+      }
+    }
+  }
+  return true;
+}
+
+// ----------------------------------------------------------------------------
+// Finds the sides that can be part of a connection and propagates the
+// removed ones until nothing changes
+//
+// A side can be part of a connection if some orientation opens it, the
+// neighbour can open the side facing it and, except for start- and
+// dest-pipe, some orientation opens it together with another usable side.
+//
+static bool propagate(Search* search)
+{
+  size_t size = grid_size(&search->game->grid);
+  for (size_t field = 0; field < size; field++)
+  {
+    uint8_t possible = possible_sides(search, field);
+    uint8_t usable = 0;
+    for (uint8_t side = 0; side < SIDES; side++)
+    {
+      size_t next = 0;
+      if ((possible & (1u << side)) && neighbour(search, field, side, &next)
+        && (possible_sides(search, next) & (1u << opposite(side))))
+      {
+        usable |= (uint8_t) (1u << side);
+      }
+    }
+    search->usable[field] = usable;
+  }
+
+  Stack pending = { NULL, 0, 0 };
+  uint8_t* queued = (uint8_t*) calloc(size, 1);
+  bool success = queued != NULL;
+  for (size_t field = 0; success && field < size; field++)
+  {
+    success = prune_field(search, field, &pending, queued);
+  }
+  while (success && pending.size > 0)
+  {
+    size_t field = pending.items[--pending.size];
+    queued[field] = 0;
+    success = prune_field(search, field, &pending, queued);
+  }
+  free(pending.items);
+  free(queued);
+  return success;
+}
+
+// ----------------------------------------------------------------------------
+// Adds a state to the bucket of <key>, the buckets are taken in the order of
+// their keys and a state is only added to the bucket it is taken from or a
+// later one
+//
+static bool queue_push(Search* search, uint32_t key, size_t state)
+{
+  if (key >= search->bucket_count)
+  {
+    size_t count = (key < 2 * search->bucket_count) ? 2 * search->bucket_count : (size_t) key + 1;
+    Stack* buckets = (Stack*) realloc(search->buckets, count * sizeof(Stack));
+    if (buckets == NULL)
+    {
+      return false;
+    }
+    memset(buckets + search->bucket_count, 0, (count - search->bucket_count) * sizeof(Stack));
+    search->buckets = buckets;
+    search->bucket_count = count;
+  }
+  return stack_push(&search->buckets[key], state);
+}
+
+// ----------------------------------------------------------------------------
+static void queue_clear(Search* search)
+{
+  for (size_t key = 0; key < search->bucket_count; key++)
+  {
+    search->buckets[key].size = 0;
+  }
+}
+
+// ----------------------------------------------------------------------------
+// Computes the fewest rotations from every state to the dest-pipe, going
+// backwards from the dest-pipe
+//
+// The branches only take orientations away, so this is never more than a
+// branch needs and guides find_walk in every branch.
+//
+static bool compute_remaining(Search* search)
+{
+  size_t states = grid_size(&search->game->grid) * SIDES;
+  for (size_t state = 0; state < states; state++)
+  {
+    search->remaining[state] = UNREACHABLE;
+  }
+  bool success = true;
+  for (uint8_t side = 0; success && side < SIDES; side++)
+  {
+    if (search->usable[search->dest] & (1u << side))
+    {
+      search->remaining[search->dest * SIDES + side] = 0;
+      success = queue_push(search, 0, search->dest * SIDES + side);
+    }
+  }
+
+  for (uint32_t key = 0; success && key < search->bucket_count; key++)
+  {
+    // queue_push can move the buckets
+    while (success && search->buckets[key].size > 0)
+    {
+      size_t state = search->buckets[key].items[--search->buckets[key].size];
+      // the state is entered from the previous field through its side <out>
+      size_t previous = 0;
+      uint8_t out = opposite((uint8_t) (state % SIDES));
+      if (search->remaining[state] != key
+        || !neighbour(search, state / SIDES, (uint8_t) (state % SIDES), &previous) || is_end(search, previous))
+      {
+        continue;
+      }
+      for (uint8_t in = 0; success && in < SIDES; in++)
+      {
+        uint8_t moves = search->turns.moves[search->openings[previous]][search->domains[previous]][in][out];
+        size_t before = previous * SIDES + in;
+        if ((search->usable[previous] & (1u << in)) && moves != NO_PAIR && key + moves < search->remaining[before])
+        {
+          search->remaining[before] = key + moves;
+          success = queue_push(search, key + moves, before);
+        }
+      }
+    }
+  }
+  queue_clear(search);
+  return success;
+}
+
+// ----------------------------------------------------------------------------
+static bool reach_state(Search* search, size_t state, uint32_t distance, size_t previous)
+{
+  if (search->remaining[state] == UNREACHABLE
+    || (search->visited[state] == search->walks && distance >= search->distance[state]))
+  {
+    return true;
+  }
+  search->visited[state] = search->walks;
+  search->distance[state] = distance;
+  search->previous[state] = previous;
+  return queue_push(search, distance + search->remaining[state], state);
+}
+
+// ----------------------------------------------------------------------------
+// Finds the walk with the fewest rotations from the start- to the dest-pipe
+//
+// A walk may go through a pipe more than once, with rotations for every
+// time. The states are taken in the order of their rotations from the start
+// plus <remaining>, which never shrinks along a walk, so only the states
+// around the best walks are looked at.
+//
+// @param goal    set to the state of the dest-pipe at the end of the walk,
+//                NO_STATE if there is no walk
+// @return        false if out of memory
+//
+static bool find_walk(Search* search, size_t* goal)
+{
+  *goal = NO_STATE;
+  search->walks++;
+  if (search->walks == 0)
+  {
+    // the counter wrapped, the old marks could be taken for new ones
+    memset(search->visited, 0, grid_size(&search->game->grid) * SIDES * sizeof(uint32_t));
+    search->walks = 1;
+  }
+
+  bool success = true;
+  for (uint8_t side = 0; success && side < SIDES; side++)
+  {
+    size_t next = 0;
+    if ((search->usable[search->start] & (1u << side)) && neighbour(search, search->start, side, &next))
+    {
+      success = reach_state(search, next * SIDES + opposite(side), 0, NO_STATE);
+    }
+  }
+
+  for (uint32_t key = 0; success && *goal == NO_STATE && key < search->bucket_count; key++)
+  {
+    if (search->stop != NULL && atomic_load_explicit(search->stop, memory_order_relaxed))
+    {
+      break;
+    }
+    // queue_push can move the buckets
+    while (success && search->buckets[key].size > 0)
+    {
+      size_t state = search->buckets[key].items[--search->buckets[key].size];
+      size_t field = state / SIDES;
+      uint8_t in = (uint8_t) (state % SIDES);
+      if (search->distance[state] + search->remaining[state] != key || field == search->start)
+      {
+        continue;   // reached with fewer rotations in the meantime
+      }
+      if (field == search->dest)
+      {
+        *goal = state;
+        break;
+      }
+      for (uint8_t out = 0; success && out < SIDES; out++)
+      {
+        size_t next = 0;
+        uint8_t moves = search->turns.moves[search->openings[field]][search->domains[field]][in][out];
+        if ((search->usable[field] & (1u << out)) && moves != NO_PAIR && neighbour(search, field, out, &next))
+        {
+          success = reach_state(search, next * SIDES + opposite(out), search->distance[state] + moves, state);
+        }
+      }
+    }
+  }
+  queue_clear(search);
+  return success;
+}
+
+// ----------------------------------------------------------------------------
+// Collects the states of the walk to <goal> into <walk>, from the dest-pipe
+// back to the start-pipe, and the sides it uses of every field into <used>
+//
+// @param conflict  set to the first field whose used sides no orientation
+//                  of its domain opens at once, NO_STATE if there is none
+// @return          false if out of memory
+//
+static bool check_walk(Search* search, size_t goal, size_t* conflict)
+{
+  search->walk.size = 0;
+  for (size_t state = goal; state != NO_STATE; state = search->previous[state])
+  {
+    if (!stack_push(&search->walk, state))
+    {
+      return false;
+    }
+  }
+
+  // the walk leaves a field towards the field of the next state
+  for (size_t i = search->walk.size - 1; i > 0; i--)
+  {
+    size_t state = search->walk.items[i];
+    uint8_t out = opposite((uint8_t) (search->walk.items[i - 1] % SIDES));
+    search->used[state / SIDES] |= (uint8_t) ((1u << (state % SIDES)) | (1u << out));
+  }
+  *conflict = NO_STATE;
+  for (size_t i = search->walk.size - 1; i > 0 && *conflict == NO_STATE; i--)
+  {
+    size_t field = search->walk.items[i] / SIDES;
+    uint8_t rights = 0;
+    if (rotations_for(search, field, search->used[field], &rights) == NO_PAIR)
+    {
+      *conflict = field;
+    }
+  }
+  return true;
+}
+
+// ----------------------------------------------------------------------------
+static void clear_walk(Search* search)
+{
+  for (size_t i = 0; i < search->walk.size; i++)
+  {
+    search->used[search->walk.items[i] / SIDES] = 0;
+  }
+}
+
+// ----------------------------------------------------------------------------
+// Turns a walk without conflicts into rotations, a field the walk goes
+// through more than once is rotated once
+//
+static bool build_solution(Search* search, Solution* solution)
+{
+  // at most 2 rotations per field
+  solution->moves = (Move*) malloc(2 * search->walk.size * sizeof(Move));
+  if (solution->moves == NULL)
+  {
+    return false;
+  }
+  for (size_t i = search->walk.size - 1; i > 0; i--)
+  {
+    size_t field = search->walk.items[i] / SIDES;
+    uint8_t rights = 0;
+    if (search->used[field] != 0 && rotations_for(search, field, search->used[field], &rights) > 0)
+    {
+      for (uint8_t move = 0; move < ((rights == 3) ? 1 : rights); move++)
+      {
+        solution->moves[solution->count].field = (uint32_t) field;
+        solution->moves[solution->count].direction = (rights == 3) ? 1 : 3;
+        solution->count++;
+      }
+    }
+    search->used[field] = 0;
+  }
+  return true;
+}
+
+// ----------------------------------------------------------------------------
+// @return  true if branch <a> is looked at before branch <b>
+//
+// Looking for the fewest rotations takes the branch with the lowest bound
+// first, otherwise the deepest one, which follows one walk and only fixes
+// its conflicts. Only one path of the tree has open branches then, so this
+// is a depth first search.
+//
+static bool branch_before(const Search* search, size_t a, size_t b)
+{
+  const Branch* first = &search->branches[a];
+  const Branch* second = &search->branches[b];
+  if (search->fewest)
+  {
+    return first->bound < second->bound || (first->bound == second->bound && first->depth > second->depth);
+  }
+  // siblings have the same depth and are made in the order of split_branch,
+  // the parallel search takes them in the same order
+  return first->depth > second->depth || (first->depth == second->depth && a < b);
+}
+
+// ----------------------------------------------------------------------------
+static bool open_push(Search* search, size_t branch)
+{
+  if (!stack_push(&search->open, branch))
+  {
+    return false;
+  }
+  size_t* heap = search->open.items;
+  for (size_t i = search->open.size - 1; i > 0 && branch_before(search, heap[i], heap[(i - 1) / 2]); i = (i - 1) / 2)
+  {
+    size_t swap = heap[i];
+    heap[i] = heap[(i - 1) / 2];
+    heap[(i - 1) / 2] = swap;
+  }
+  return true;
+}
+
+// ----------------------------------------------------------------------------
+static size_t open_pop(Search* search)
+{
+  size_t* heap = search->open.items;
+  size_t top = heap[0];
+  heap[0] = heap[--search->open.size];
+  size_t i = 0;
+  while (true)
+  {
+    size_t best = i;
+    for (size_t child = 2 * i + 1; child <= 2 * i + 2 && child < search->open.size; child++)
+    {
+      best = branch_before(search, heap[child], heap[best]) ? child : best;
+    }
+    if (best == i)
+    {
+      return top;
+    }
+    size_t swap = heap[i];
+    heap[i] = heap[best];
+    heap[best] = swap;
+    i = best;
+  }
+}
+
+// ----------------------------------------------------------------------------
+static bool add_branch(Search* search, size_t parent, size_t field, uint8_t domain, uint32_t bound)
+{
+  if (search->branch_count == search->branch_capacity)
+  {
+    size_t capacity = (search->branch_capacity == 0) ? 64 : search->branch_capacity * 2;
+    Branch* branches = (Branch*) realloc(search->branches, capacity * sizeof(Branch));
+    if (branches == NULL)
+    {
+      return false;
+    }
+    search->branches = branches;
+    search->branch_capacity = capacity;
+  }
+  uint32_t depth = (parent == NO_BRANCH) ? 0 : search->branches[parent].depth + 1;
+  search->branches[search->branch_count] = (Branch) { parent, field, domain, depth, bound };
+  return open_push(search, search->branch_count++);
+}
+
+// ----------------------------------------------------------------------------
+// Limits the domains to the ones of a branch and its parents, or sets them
+// back to <all> with <limit> false
+//
+static void apply_branch(Search* search, size_t branch, bool limit, const uint8_t* all)
+{
+  for (; branch != NO_BRANCH; branch = search->branches[branch].parent)
+  {
+    const Branch* node = &search->branches[branch];
+    if (node->field != NO_STATE)
+    {
+      search->domains[node->field] = limit ? (search->domains[node->field] & node->domain) : all[node->field];
+    }
+  }
+}
+
+// ----------------------------------------------------------------------------
+// Splits a branch at a field its walk uses in a way no orientation allows,
+// with one child for every set of orientations that open the same sides
+//
+static bool split_branch(Search* search, size_t branch, size_t field, uint32_t bound)
+{
+  uint8_t n = search->openings[field];
+  uint8_t domain = search->domains[field];
+  uint8_t done = 0;
+  for (uint8_t k = 0; k < SIDES; k++)
+  {
+    if (!(domain & ~done & (1u << k)))
+    {
+      continue;
+    }
+    uint8_t same = 0;
+    for (uint8_t other = k; other < SIDES; other++)
+    {
+      if ((domain & (1u << other)) && search->turns.rotated[n][other] == search->turns.rotated[n][k])
+      {
+        same |= (uint8_t) (1u << other);
+      }
+    }
+    done |= same;
+    if (!add_branch(search, branch, field, same, bound))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+// ----------------------------------------------------------------------------
+// Keeps the walk without conflicts as <solution> if it has fewer rotations
+// than the one kept so far
+//
+// @return  false if out of memory
+//
+static bool keep_better(Search* search, Solution* solution)
+{
+  Solution walk = { NULL, 0 };
+  if (!build_solution(search, &walk))
+  {
+    return false;
+  }
+  if (solution->moves == NULL || walk.count < solution->count)
+  {
+    Solution swap = *solution;
+    *solution = walk;
+    walk = swap;
+  }
+  solution_free(&walk);
+  return true;
+}
+
+// ----------------------------------------------------------------------------
+// Looks at the branches in the order of branch_before until a walk has no
+// conflict, or until the budget is used up
+//
+static SolverResult search_branches(Search* search, const uint8_t* all, Solution* solution)
+{
+  if (!add_branch(search, NO_BRANCH, NO_STATE, 0, 0))
+  {
+    return SOLVER_MEMORY;
+  }
+  for (size_t looked = 0; search->open.size > 0; looked++)
+  {
+    if (search->budget != 0 && looked == search->budget)
+    {
+      return SOLVER_LIMIT;
+    }
+    size_t branch = open_pop(search);
+    apply_branch(search, branch, true, all);
+    size_t goal = NO_STATE;
+    size_t conflict = NO_STATE;
+    bool success = find_walk(search, &goal) && (goal == NO_STATE || check_walk(search, goal, &conflict));
+    if (success && goal != NO_STATE)
+    {
+      uint32_t distance = search->distance[goal];
+      if (conflict != NO_STATE)
+      {
+        clear_walk(search);
+        success = split_branch(search, branch, conflict, distance);
+      }
+      else if (search->fewest && distance > search->branches[branch].bound)
+      {
+        // a branch with a lower bound may still have a path with fewer
+        // rotations
+        search->branches[branch].bound = distance;
+        if (search->budget == 0)
+        {
+          clear_walk(search);
+        }
+        else
+        {
+          // the best so far if the budget runs out, building it clears the
+          // walk
+          success = keep_better(search, solution);
+        }
+        success = success && open_push(search, branch);
+      }
+      else
+      {
+        solution_free(solution);
+        success = build_solution(search, solution);
+        apply_branch(search, branch, false, all);
+        return success ? SOLVER_OK : SOLVER_MEMORY;
+      }
+    }
+    apply_branch(search, branch, false, all);
+    if (!success)
+    {
+      return SOLVER_MEMORY;
+    }
+  }
+  return SOLVER_UNSOLVABLE;
+}
+
+// ----------------------------------------------------------------------------
+// Allocates what every search needs for its own walks, the domains start as
+// <domains>
+//
+static bool alloc_walks(Search* search, const uint8_t* domains)
+{
+  size_t size = grid_size(&search->game->grid);
+  search->domains = (uint8_t*) malloc(size);
+  search->used = (uint8_t*) calloc(size, 1);
+  search->distance = (uint32_t*) malloc(size * SIDES * sizeof(uint32_t));
+  search->previous = (size_t*) malloc(size * SIDES * sizeof(size_t));
+  search->visited = (uint32_t*) calloc(size * SIDES, sizeof(uint32_t));
+  if (search->domains == NULL || search->used == NULL || search->distance == NULL || search->previous == NULL
+    || search->visited == NULL)
+  {
+    return false;
+  }
+  if (domains != NULL)
+  {
+    memcpy(search->domains, domains, size);
+  }
+  return true;
+}
+
+// ----------------------------------------------------------------------------
+static void free_walks(Search* search)
+{
+  free(search->domains);
+  free(search->used);
+  free(search->distance);
+  free(search->previous);
+  free(search->visited);
+  for (size_t i = 0; i < search->bucket_count; i++)
+  {
+    free(search->buckets[i].items);
+  }
+  free(search->buckets);
+  free(search->walk.items);
+  free(search->branches);
+  free(search->open.items);
+}
+
+// ----------------------------------------------------------------------------
+// Sets up a search of the game up to the point where the branches start:
+// the loaded domains are in <all>, the usable sides are propagated and the
+// remaining rotations computed
+//
+// @return  false if out of memory, the search has to be freed with
+//          free_search in any case
+//
+static bool init_search(Search* search, const Game* game, uint8_t** all)
+{
+  const Grid* grid = &game->grid;
+  size_t size = grid_size(grid);
+  memset(search, 0, sizeof(Search));
+  search->game = game;
+  search->width = grid->width;
+  search->height = grid->height;
+  search->start = (size_t) game->start[0] * grid->width + game->start[1];
+  search->dest = (size_t) game->dest[0] * grid->width + game->dest[1];
+  build_turns(&search->turns);
+  search->openings = (uint8_t*) malloc(size);
+  search->usable = (uint8_t*) malloc(size);
+  search->remaining = (uint32_t*) malloc(size * SIDES * sizeof(uint32_t));
+  *all = (uint8_t*) malloc(size);
+  if (!alloc_walks(search, NULL) || search->openings == NULL || search->usable == NULL || search->remaining == NULL
+    || *all == NULL)
+  {
+    return false;
+  }
+
+  // start- and dest-pipe, walls and 255 can not be rotated
+  for (size_t field = 0; field < size; field++)
+  {
+    uint8_t value = grid->fields[field];
+    search->openings[field] = openings_of(value);
+    search->domains[field] = (is_end(search, field) || value == 0 || value == 255) ? 1 : ALL_ORIENTATIONS;
+  }
+  // the branches change the domains, <all> is what they go back to
+  memcpy(*all, search->domains, size);
+  return propagate(search) && compute_remaining(search);
+}
+
+// ----------------------------------------------------------------------------
+static void free_search(Search* search, uint8_t* all)
+{
+  free(search->openings);
+  free(search->usable);
+  free(search->remaining);
+  free(all);
+  free_walks(search);
+}
+
+// ----------------------------------------------------------------------------
+SolverResult solver_solve(const Game* game, bool fewest, Solution* solution)
+{
+  return solver_solve_limited(game, fewest, 0, solution);
+}
+
+// ----------------------------------------------------------------------------
+SolverResult solver_solve_limited(const Game* game, bool fewest, size_t budget, Solution* solution)
+{
+  Search search;
+  uint8_t* all = NULL;
+  solution->moves = NULL;
+  solution->count = 0;
+  SolverResult result = SOLVER_MEMORY;
+  if (init_search(&search, game, &all))
+  {
+    search.fewest = fewest;
+    search.budget = budget;
+    result = search_branches(&search, all, solution);
+  }
+  free_search(&search, all);
+  if (result != SOLVER_OK && result != SOLVER_LIMIT)
+  {
+    solution_free(solution);
+  }
+  return result;
+}
+
+// ----------------------------------------------------------------------------
+// A branch of the parallel search, limiting one pipe to some of its
+// orientations on top of the limits of its parent
+//
+// Tasks are never changed once they were pushed, so the parents can be read
+// by every thread. <index> is the position among the children of the parent.
+//
+typedef struct _Task_
+{
+  const struct _Task_* parent;
+  struct _Task_* allocated;   // the task allocated before by the same thread
+  size_t field;
+  uint8_t domain;
+  uint8_t index;
+  uint32_t depth;
+} Task;
+
+// ----------------------------------------------------------------------------
+// Tasks of one thread, the thread itself pushes and pops at the tail, the
+// other threads steal from the head
+//
+typedef struct _Deque_
+{
+  pthread_mutex_t lock;
+  Task** items;
+  size_t head;
+  size_t tail;
+  size_t capacity;
+} Deque;
+
+typedef struct _Pool_ Pool;
+
+// ----------------------------------------------------------------------------
+typedef struct _Worker_
+{
+  pthread_t thread;
+  Pool* pool;
+  size_t id;
+  Search search;
+  Deque deque;
+  Task* allocated;    // the last task allocated by this thread
+} Worker;
+
+// ----------------------------------------------------------------------------
+// <pending> counts the tasks that were pushed and are not finished yet, a
+// task pushes its children before it finishes, so there is no task left
+// once it is 0. <queued> counts the tasks in the deques. <lock> guards
+// <best>, <solution>, <found> and <memory>, <best> is only valid while the
+// pool runs.
+//
+// A thread that finds no task waits on <wake> until a task is pushed, the
+// search is stopped or <pending> reaches 0. <sleeping> counts the waiting
+// threads, so pushing only takes <idle_lock> if a thread waits.
+//
+struct _Pool_
+{
+  Worker* workers;
+  size_t count;
+  const uint8_t* all;
+  bool deterministic;
+  atomic_size_t pending;
+  atomic_size_t queued;
+  atomic_bool stop;
+  pthread_mutex_t lock;
+  pthread_mutex_t idle_lock;
+  pthread_cond_t wake;
+  atomic_size_t sleeping;
+  const Task* best;
+  Solution solution;
+  bool found;
+  bool memory;
+};
+
+// ----------------------------------------------------------------------------
+static bool deque_push(Deque* deque, Task* task)
+{
+  pthread_mutex_lock(&deque->lock);
+  if (deque->tail == deque->capacity)
+  {
+    // the stolen tasks at the head make room first
+    size_t size = deque->tail - deque->head;
+    size_t capacity = (size * 2 < deque->capacity) ? deque->capacity
+      : ((deque->capacity == 0) ? 64 : deque->capacity * 2);
+    Task** items = (capacity == deque->capacity) ? deque->items
+      : (Task**) realloc(deque->items, capacity * sizeof(Task*));
+    if (items == NULL)
+    {
+      pthread_mutex_unlock(&deque->lock);
+      return false;
+    }
+    memmove(items, items + deque->head, size * sizeof(Task*));
+    deque->items = items;
+    deque->capacity = capacity;
+    deque->head = 0;
+    deque->tail = size;
+  }
+  deque->items[deque->tail++] = task;
+  pthread_mutex_unlock(&deque->lock);
+  return true;
+}
+
+// ----------------------------------------------------------------------------
+// @param steal   take the oldest task instead of the newest one
+// @return        the task, NULL if the deque is empty
+//
+static Task* deque_pop(Deque* deque, bool steal)
+{
+  Task* task = NULL;
+  pthread_mutex_lock(&deque->lock);
+  if (deque->head < deque->tail)
+  {
+    task = steal ? deque->items[deque->head++] : deque->items[--deque->tail];
+  }
+  pthread_mutex_unlock(&deque->lock);
+  return task;
+}
+
+// ----------------------------------------------------------------------------
+// Wakes one waiting thread for a new task, or every thread once the pool
+// is done
+//
+static void wake_workers(Pool* pool, bool all)
+{
+  if (atomic_load(&pool->sleeping) == 0)
+  {
+    return;
+  }
+  pthread_mutex_lock(&pool->idle_lock);
+  if (all)
+  {
+    pthread_cond_broadcast(&pool->wake);
+  }
+  else
+  {
+    pthread_cond_signal(&pool->wake);
+  }
+  pthread_mutex_unlock(&pool->idle_lock);
+}
+
+// ----------------------------------------------------------------------------
+// Stops the search of every thread
+//
+static void stop_pool(Pool* pool)
+{
+  atomic_store(&pool->stop, true);
+  wake_workers(pool, true);
+}
+
+// ----------------------------------------------------------------------------
+// Waits until a task may have been pushed, the search was stopped or no task
+// is left
+//
+static void wait_for_task(Pool* pool)
+{
+  pthread_mutex_lock(&pool->idle_lock);
+  // <sleeping> is raised before <queued> is read and push_task raises
+  // <queued> before it reads <sleeping>, so one of both sees the other
+  atomic_fetch_add(&pool->sleeping, 1);
+  while (atomic_load(&pool->queued) == 0 && atomic_load(&pool->pending) > 0 && !atomic_load(&pool->stop))
+  {
+    pthread_cond_wait(&pool->wake, &pool->idle_lock);
+  }
+  atomic_fetch_sub(&pool->sleeping, 1);
+  pthread_mutex_unlock(&pool->idle_lock);
+}
+
+// ----------------------------------------------------------------------------
+static bool push_task(Worker* worker, const Task* parent, size_t field, uint8_t domain, uint8_t index)
+{
+  Task* task = (Task*) malloc(sizeof(Task));
+  if (task == NULL)
+  {
+    return false;
+  }
+  *task = (Task) { parent, worker->allocated, field, domain, index, (parent == NULL) ? 0 : parent->depth + 1 };
+  worker->allocated = task;
+  atomic_fetch_add(&worker->pool->pending, 1);
+  atomic_fetch_add(&worker->pool->queued, 1);
+  if (!deque_push(&worker->deque, task))
+  {
+    atomic_fetch_sub(&worker->pool->queued, 1);
+    atomic_fetch_sub(&worker->pool->pending, 1);
+    return false;
+  }
+  wake_workers(worker->pool, false);
+  return true;
+}
+
+// ----------------------------------------------------------------------------
+// @return  true if the depth first search of solver_solve looks at task <a>
+//          before task <b>
+//
+static bool task_before(const Task* a, const Task* b)
+{
+  while (a->depth > b->depth)
+  {
+    a = a->parent;
+  }
+  while (b->depth > a->depth)
+  {
+    if (b->parent == a)
+    {
+      return true;
+    }
+    b = b->parent;
+  }
+  while (a != b && a->parent != b->parent)
+  {
+    a = a->parent;
+    b = b->parent;
+  }
+  return a != b && a->index < b->index;
+}
+
+// ----------------------------------------------------------------------------
+// Keeps the solution of a task if it is the first one or, in deterministic
+// mode, the first one in the order of the depth first search
+//
+static void offer_solution(Pool* pool, const Task* task, Solution* solution)
+{
+  pthread_mutex_lock(&pool->lock);
+  if (pool->best == NULL || (pool->deterministic && task_before(task, pool->best)))
+  {
+    Solution swap = pool->solution;
+    pool->solution = *solution;
+    *solution = swap;
+    pool->best = task;
+    pool->found = true;
+  }
+  pthread_mutex_unlock(&pool->lock);
+  if (!pool->deterministic)
+  {
+    stop_pool(pool);
+  }
+  solution_free(solution);
+}
+
+// ----------------------------------------------------------------------------
+// @return  false if the task can not lead to the solution that is kept
+//
+static bool task_needed(Pool* pool, const Task* task)
+{
+  if (atomic_load(&pool->stop))
+  {
+    return false;
+  }
+  pthread_mutex_lock(&pool->lock);
+  bool needed = pool->best == NULL || task_before(task, pool->best);
+  pthread_mutex_unlock(&pool->lock);
+  return needed;
+}
+
+// ----------------------------------------------------------------------------
+// Looks at one task like search_branches looks at a branch, its children
+// are pushed so that the first one is popped next
+//
+// @return  false if out of memory
+//
+static bool run_task(Worker* worker, const Task* task)
+{
+  Search* search = &worker->search;
+  const uint8_t* all = worker->pool->all;
+  for (const Task* limit = task; limit != NULL; limit = limit->parent)
+  {
+    if (limit->field != NO_STATE)
+    {
+      search->domains[limit->field] &= limit->domain;
+    }
+  }
+
+  size_t goal = NO_STATE;
+  size_t conflict = NO_STATE;
+  bool success = find_walk(search, &goal) && (goal == NO_STATE || check_walk(search, goal, &conflict));
+  if (success && goal != NO_STATE && conflict != NO_STATE)
+  {
+    clear_walk(search);
+    uint8_t n = search->openings[conflict];
+    uint8_t domain = search->domains[conflict];
+    uint8_t groups[SIDES];
+    uint8_t count = 0;
+    uint8_t done = 0;
+    for (uint8_t k = 0; k < SIDES; k++)
+    {
+      if (domain & ~done & (1u << k))
+      {
+        groups[count] = 0;
+        for (uint8_t other = k; other < SIDES; other++)
+        {
+          if ((domain & (1u << other)) && search->turns.rotated[n][other] == search->turns.rotated[n][k])
+          {
+            groups[count] |= (uint8_t) (1u << other);
+          }
+        }
+        done |= groups[count++];
+      }
+    }
+    for (uint8_t index = count; success && index > 0; index--)
+    {
+      success = push_task(worker, task, conflict, groups[index - 1], (uint8_t) (index - 1));
+    }
+  }
+  else if (success && goal != NO_STATE)
+  {
+    Solution solution = { NULL, 0 };
+    success = build_solution(search, &solution);
+    if (success)
+    {
+      offer_solution(worker->pool, task, &solution);
+    }
+  }
+
+  for (const Task* limit = task; limit != NULL; limit = limit->parent)
+  {
+    if (limit->field != NO_STATE)
+    {
+      search->domains[limit->field] = all[limit->field];
+    }
+  }
+  return success;
+}
+
+// ----------------------------------------------------------------------------
+// Takes tasks from the own deque and steals from the others when it is
+// empty, until no task is left or the search was stopped. A thread that
+// finds no task waits instead of spinning.
+//
+static void* run_worker(void* argument)
+{
+  Worker* worker = (Worker*) argument;
+  Pool* pool = worker->pool;
+  while (!atomic_load(&pool->stop) && atomic_load(&pool->pending) > 0)
+  {
+    Task* task = deque_pop(&worker->deque, false);
+    for (size_t i = 1; task == NULL && i < pool->count; i++)
+    {
+      task = deque_pop(&pool->workers[(worker->id + i) % pool->count].deque, true);
+    }
+    if (task == NULL)
+    {
+      wait_for_task(pool);
+      continue;
+    }
+    atomic_fetch_sub(&pool->queued, 1);
+    // a thread that never gets a task does not need memory for walks
+    if (task_needed(pool, task)
+      && ((worker->search.domains == NULL && !alloc_walks(&worker->search, pool->all)) || !run_task(worker, task)))
+    {
+      pthread_mutex_lock(&pool->lock);
+      pool->memory = true;
+      pthread_mutex_unlock(&pool->lock);
+      stop_pool(pool);
+    }
+    if (atomic_fetch_sub(&pool->pending, 1) == 1)
+    {
+      wake_workers(pool, true);
+    }
+  }
+  return NULL;
+}
+
+// ----------------------------------------------------------------------------
+// Starts a search that reads the loaded map, the usable sides and the
+// remaining rotations of <shared>, it needs alloc_walks for its own walks
+//
+static void share_search(Search* search, const Search* shared)
+{
+  memset(search, 0, sizeof(Search));
+  search->game = shared->game;
+  search->width = shared->width;
+  search->height = shared->height;
+  search->start = shared->start;
+  search->dest = shared->dest;
+  search->turns = shared->turns;
+  search->openings = shared->openings;
+  search->usable = shared->usable;
+  search->remaining = shared->remaining;
+}
+
+// ----------------------------------------------------------------------------
+// Runs the workers of the pool, the calling thread is the first one
+//
+// @return  false if out of memory
+//
+static bool run_pool(Pool* pool, const Search* shared)
+{
+  for (size_t i = 0; i < pool->count; i++)
+  {
+    Worker* worker = &pool->workers[i];
+    memset(worker, 0, sizeof(Worker));
+    worker->pool = pool;
+    worker->id = i;
+    share_search(&worker->search, shared);
+    worker->search.stop = &pool->stop;
+    pthread_mutex_init(&worker->deque.lock, NULL);
+  }
+  bool success = push_task(&pool->workers[0], NULL, NO_STATE, 0, 0);
+
+  size_t started = 1;
+  for (; success && started < pool->count; started++)
+  {
+    if (pthread_create(&pool->workers[started].thread, NULL, run_worker, &pool->workers[started]) != 0)
+    {
+      break;
+    }
+  }
+  if (success)
+  {
+    run_worker(&pool->workers[0]);
+  }
+  for (size_t i = 1; success && i < started; i++)
+  {
+    pthread_join(pool->workers[i].thread, NULL);
+  }
+
+  for (size_t i = 0; i < pool->count; i++)
+  {
+    Worker* worker = &pool->workers[i];
+    while (worker->allocated != NULL)
+    {
+      Task* task = worker->allocated;
+      worker->allocated = task->allocated;
+      free(task);
+    }
+    free(worker->deque.items);
+    pthread_mutex_destroy(&worker->deque.lock);
+    free_walks(&worker->search);
+  }
+  return success;
+}
+
+// ----------------------------------------------------------------------------
+SolverResult solver_solve_parallel(const Game* game, size_t threads, bool deterministic, Solution* solution)
+{
+  if (threads == 0)
+  {
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    threads = (online > 0) ? (size_t) online : 1;
+  }
+  threads = (threads > SOLVER_THREADS_MAX) ? SOLVER_THREADS_MAX : threads;
+
+  Search search;
+  uint8_t* all = NULL;
+  bool success = init_search(&search, game, &all);
+  // only pipes that can be rotated and are still usable split the search
+  size_t pipes = 0;
+  for (size_t field = 0; success && field < grid_size(&game->grid); field++)
+  {
+    pipes += (all[field] == ALL_ORIENTATIONS && search.usable[field] != 0) ? 1 : 0;
+  }
+  size_t useful = 1 + pipes / SOLVER_PIPES_PER_THREAD;
+  threads = (threads > useful) ? useful : threads;
+
+  Pool pool;
+  memset(&pool, 0, sizeof(pool));
+  pool.workers = (Worker*) malloc(threads * sizeof(Worker));
+  pool.count = threads;
+  pool.all = all;
+  pool.deterministic = deterministic;
+  atomic_init(&pool.pending, 0);
+  atomic_init(&pool.queued, 0);
+  atomic_init(&pool.stop, false);
+  atomic_init(&pool.sleeping, 0);
+  pthread_mutex_init(&pool.lock, NULL);
+  pthread_mutex_init(&pool.idle_lock, NULL);
+  pthread_cond_init(&pool.wake, NULL);
+
+  success = success && pool.workers != NULL && run_pool(&pool, &search) && !pool.memory;
+  free(pool.workers);
+  pthread_mutex_destroy(&pool.lock);
+  pthread_mutex_destroy(&pool.idle_lock);
+  pthread_cond_destroy(&pool.wake);
+  free_search(&search, all);
+
+  *solution = pool.solution;
+  if (!success)
+  {
+    solution_free(solution);
+    return SOLVER_MEMORY;
+  }
+  return pool.found ? SOLVER_OK : SOLVER_UNSOLVABLE;
+}
+
+// ----------------------------------------------------------------------------
+void solution_free(Solution* solution)
+{
+  free(solution->moves);
+  solution->moves = NULL;
+  solution->count = 0;
+}
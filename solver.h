@@ -0,0 +1,113 @@
+#ifndef SOLVER_H
+#define SOLVER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "game.h"
+
+// most threads solver_solve_parallel uses
+#define SOLVER_THREADS_MAX 256
+
+// solver_solve_parallel uses one thread per this many pipes that can be
+// rotated, small maps are searched on the calling thread alone
+#define SOLVER_PIPES_PER_THREAD 64
+
+typedef enum _SolverResult_
+{
+  SOLVER_OK,
+  SOLVER_UNSOLVABLE,    // start- and dest-pipe can not be connected
+  SOLVER_MEMORY,
+  SOLVER_LIMIT          // the budget of solver_solve_limited was used up
+} SolverResult;
+
+// ----------------------------------------------------------------------------
+// Rotations that connect start- and dest-pipe, in the format of the journal
+//
+typedef struct _Solution_
+{
+  Move* moves;
+  size_t count;
+} Solution;
+
+// ----------------------------------------------------------------------------
+// Finds rotations that connect start- and dest-pipe of the current map
+//
+// First the sides of every pipe that can never be part of a connection are
+// removed: sides facing the border, a wall or a pipe that can not open
+// towards them, and sides that no rotation of the pipe combines with another
+// usable side. The removals are propagated to the neighbours until nothing
+// changes.
+//
+// Then the walk with the fewest rotations is searched, which may go through
+// a pipe more than once in ways no single rotation of it allows. Such a pipe
+// is limited to each of its rotations in turn and the walk is searched again,
+// until a walk has no such conflict. The pipes on it are the only ones that
+// are rotated.
+//
+// With <fewest> the limits with the fewest rotations are tried first, so the
+// result has the fewest rotations possible, but the number of tries can grow
+// fast on big maps. Otherwise the conflicts of one walk are fixed one after
+// the other, which is usually close to the fewest rotations.
+//
+// The map of the game is not changed.
+//
+// @param game        the game
+// @param fewest      find the solution with the fewest rotations
+// @param solution    set to the rotations on success, free with solution_free
+// @return            SOLVER_OK, SOLVER_UNSOLVABLE or SOLVER_MEMORY
+//
+SolverResult solver_solve(const Game* game, bool fewest, Solution* solution);
+
+// ----------------------------------------------------------------------------
+// Finds rotations like solver_solve, but gives up after looking at <budget>
+// branches of the search, i.e. walks with their limits
+//
+// With <fewest>, every walk without conflict that is found on the way has
+// to be checked against branches with fewer rotations. The one with the
+// fewest rotations of these is kept, so a search that runs out of budget
+// still returns the best solution found so far.
+//
+// @param game        the game
+// @param fewest      find the solution with the fewest rotations
+// @param budget      most branches to look at, 0 for no limit
+// @param solution    set to the rotations on success, and to the best ones
+//                    found so far on SOLVER_LIMIT (without moves if none
+//                    was found); free with solution_free
+// @return            SOLVER_OK, SOLVER_UNSOLVABLE, SOLVER_MEMORY or
+//                    SOLVER_LIMIT
+//
+SolverResult solver_solve_limited(const Game* game, bool fewest, size_t budget, Solution* solution);
+
+// ----------------------------------------------------------------------------
+// Finds rotations like solver_solve without <fewest>, on several threads
+//
+// The pipes a walk can not use at once split the search into tasks, which
+// are spread over a pool of threads. Every thread works on its own tasks
+// depth first and steals the oldest task of another thread when it has
+// none left. Once a solution is found the other threads stop.
+//
+// Which thread finds a solution first changes from run to run. In
+// <deterministic> mode the threads only stop working on the tasks that come
+// after the found solution in the order of solver_solve, so the result is
+// always the one solver_solve finds.
+//
+// @param game            the game
+// @param threads         most threads, 0 for one per processor; fewer are
+//                        used on small maps, see SOLVER_PIPES_PER_THREAD
+// @param deterministic   return the solution solver_solve returns
+// @param solution        set to the rotations on success, free with
+//                        solution_free
+// @return                SOLVER_OK, SOLVER_UNSOLVABLE or SOLVER_MEMORY
+//
+SolverResult solver_solve_parallel(const Game* game, size_t threads, bool deterministic, Solution* solution);
+
+// ----------------------------------------------------------------------------
+// Frees the rotations of a solution
+//
+// @param solution    the solution
+//
+void solution_free(Solution* solution);
+
+#endif
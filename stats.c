@@ -0,0 +1,51 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "stats.h"
+
+static const char* const PHASE_NAMES[STATS_PHASES] =
+{
+  [STATS_INPUT] = "input",
+  [STATS_ROTATE] = "rotate",
+  [STATS_REBUILD] = "rebuild",
+  [STATS_CONNECTED] = "connected",
+  [STATS_RENDER] = "render",
+};
+
+// ----------------------------------------------------------------------------
+void stats_init(Stats* stats)
+{
+  const char* mode = getenv(STATS_ENV);
+  memset(stats, 0, sizeof(Stats));
+  stats->enabled = mode != NULL && strcmp(mode, "1") == 0;
+}
+
+// ----------------------------------------------------------------------------
+uint64_t stats_now(void)
+{
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return (uint64_t) time.tv_sec * 1000000000u + (uint64_t) time.tv_nsec;
+}
+
+// ----------------------------------------------------------------------------
+void stats_print(const Stats* stats, FILE* file)
+{
+  if (!stats->enabled)
+  {
+    fprintf(file, "%s", INFO_STATS_DISABLED);
+    return;
+  }
+  fprintf(file, "Stats:\n");
+  for (int phase = 0; phase < STATS_PHASES; phase++)
+  {
+    uint64_t calls = stats->calls[phase];
+    uint64_t nanoseconds = stats->nanoseconds[phase];
+    fprintf(file, "   %-10s %10" PRIu64 " calls %12.3f ms %10.1f ns/call\n", PHASE_NAMES[phase], calls,
+      nanoseconds / 1e6, (calls > 0) ? (double) nanoseconds / calls : 0.0);
+  }
+}
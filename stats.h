@@ -0,0 +1,87 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// environment variable that turns on the timers and the dump at exit, e.g.
+// A3_STATS=1 ./a3 CONFIG_FILE
+#define STATS_ENV "A3_STATS"
+
+#define INFO_STATS_DISABLED "Stats are disabled, set " STATS_ENV "=1 to enable them\n"
+
+// ----------------------------------------------------------------------------
+// Parts of a turn that are timed separately
+//
+typedef enum _StatsPhase_
+{
+  STATS_INPUT,      // reading and parsing the command
+  STATS_ROTATE,     // rotate, undo, redo and restart incl. the update of the connections
+  STATS_REBUILD,    // end of the turn, incl. the full rebuild after loading
+  STATS_CONNECTED,  // checking if start- and dest-pipe are connected
+  STATS_RENDER,     // printing the map
+  STATS_PHASES
+} StatsPhase;
+
+// ----------------------------------------------------------------------------
+// Number of calls and time spent in every phase
+//
+// Nothing is counted while <enabled> is false, the only cost left then is
+// one branch per phase and turn.
+//
+typedef struct _Stats_
+{
+  bool enabled;
+  uint64_t calls[STATS_PHASES];
+  uint64_t nanoseconds[STATS_PHASES];
+} Stats;
+
+// ----------------------------------------------------------------------------
+// Clears the counters and enables them if STATS_ENV is set to 1
+//
+// @param stats   the counters
+//
+void stats_init(Stats* stats);
+
+// ----------------------------------------------------------------------------
+// @return  nanoseconds of the monotonic clock
+//
+uint64_t stats_now(void);
+
+// ----------------------------------------------------------------------------
+// Prints the calls, the total time and the time per call of every phase
+//
+// @param stats   the counters
+// @param file    where to print them
+//
+void stats_print(const Stats* stats, FILE* file);
+
+// ----------------------------------------------------------------------------
+// Starts timing a phase
+//
+// @param stats   the counters
+// @return        the start time to pass to stats_stop
+//
+static inline uint64_t stats_start(const Stats* stats)
+{
+  return stats->enabled ? stats_now() : 0;
+}
+
+// ----------------------------------------------------------------------------
+// Stops timing a phase and adds it to the counters
+//
+// @param stats   the counters
+// @param phase   the phase that was timed
+// @param start   return value of stats_start
+//
+static inline void stats_stop(Stats* stats, StatsPhase phase, uint64_t start)
+{
+  if (stats->enabled)
+  {
+    stats->calls[phase]++;
+    stats->nanoseconds[phase] += stats_now() - start;
+  }
+}
+
+#endif
@@ -0,0 +1,404 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <dirent.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "framework.h"
+#include "game.h"
+#include "level.h"
+#include "solver.h"
+
+#define USAGE_VALIDATOR "Usage: ./validate CONFIG_FILE_OR_DIRECTORY...\n"
+#define ERROR_DIRECTORY "Error: Cannot read directory: %s\n"
+
+// one line per config file, separated by tabs, then the summary
+#define VALIDATOR_HEADER  "file\tstatus\twidth\theight\tmoves\tms\n"
+#define VALIDATOR_RESULT  "%s%s\t%s\t%u\t%u\t%s\t%.1f\n"
+#define VALIDATOR_SUMMARY "%zu files in %.1f s on %zu threads: %zu ok, %zu connected, %zu timeout, " \
+  "%zu unsolvable, %zu invalid, %zu unreadable, %zu out of memory\n"
+
+// appended to the path of a level pack in the line of one of its levels
+#define VALIDATOR_LEVEL   "#%u"
+
+// files in a directory that are config files
+#define CONFIG_EXTENSION ".bin"
+
+// the search for the fewest rotations of a file looks at no more than this
+// many branches divided by the fields of its map; every branch walks the
+// map once, so this bounds the time spent on one file
+#define VALIDATOR_BUDGET ((size_t) 1 << 26)
+
+// ----------------------------------------------------------------------------
+// What is found out about a config file, in the order of the summary
+//
+typedef enum _Status_
+{
+  STATUS_OK,          // can be solved
+  STATUS_CONNECTED,   // start- and dest-pipe are connected as loaded
+  STATUS_TIMEOUT,     // can be solved, but the fewest rotations were not
+                      // found within VALIDATOR_BUDGET
+  STATUS_UNSOLVABLE,
+  STATUS_INVALID,
+  STATUS_UNREADABLE,
+  STATUS_MEMORY,
+  STATUS_COUNT
+} Status;
+
+static const char* const STATUS_NAMES[STATUS_COUNT] =
+{
+  "ok", "connected", "timeout", "unsolvable", "invalid", "unreadable", "out of memory"
+};
+
+// ----------------------------------------------------------------------------
+typedef struct _Result_
+{
+  char* path;       // shared by the levels of a pack, owned by the first
+  uint32_t number;  // level in a pack, starting at 1, 0 for a config file
+  Status status;
+  uint32_t width;
+  uint32_t height;
+  size_t moves;     // fewest rotations to connect the pipes, if solvable;
+                    // on timeout the fewest found, SIZE_MAX if none
+  double ms;
+} Result;
+
+// ----------------------------------------------------------------------------
+// The config files and the index of the next one a thread takes
+//
+typedef struct _Pack_
+{
+  Result* results;
+  size_t count;
+  size_t capacity;
+  atomic_size_t next;
+} Pack;
+
+// ----------------------------------------------------------------------------
+static double now_ms(void)
+{
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return time.tv_sec * 1e3 + time.tv_nsec / 1e6;
+}
+
+// ----------------------------------------------------------------------------
+// @param path    the path, taken over by the pack on success
+// @param number  the level in a pack, 0 for a config file
+// @return        false if out of memory
+//
+static bool add_file(Pack* pack, char* path, uint32_t number)
+{
+  if (pack->count == pack->capacity)
+  {
+    size_t capacity = (pack->capacity == 0) ? 64 : pack->capacity * 2;
+    Result* results = (Result*) realloc(pack->results, capacity * sizeof(Result));
+    if (results == NULL)
+    {
+      return false;
+    }
+    pack->results = results;
+    pack->capacity = capacity;
+  }
+  memset(&pack->results[pack->count], 0, sizeof(Result));
+  pack->results[pack->count].path = path;
+  pack->results[pack->count++].number = number;
+  return true;
+}
+
+// ----------------------------------------------------------------------------
+// Adds a config file, or every level if it is a level pack. Only the header
+// of a pack is read here, a file that can not be opened is added as it is and
+// shows up as unreadable.
+//
+// @param path  the path, taken over by the pack, also if out of memory
+// @return      false if out of memory
+//
+static bool add_levels(Pack* pack, char* path)
+{
+  LevelPack levels;
+  uint32_t count = 0;
+  if (level_pack_open(&levels, path) == LEVEL_OK)
+  {
+    count = levels.indexed ? levels.count : 0;
+    level_pack_close(&levels);
+  }
+  if (!add_file(pack, path, (count == 0) ? 0 : 1))
+  {
+    free(path);
+    return false;
+  }
+  for (uint32_t number = 2; number <= count; number++)
+  {
+    if (!add_file(pack, path, number))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+// ----------------------------------------------------------------------------
+static int compare_paths(const void* a, const void* b)
+{
+  const Result* first = (const Result*) a;
+  const Result* second = (const Result*) b;
+  int order = strcmp(first->path, second->path);
+  if (order != 0)
+  {
+    return order;
+  }
+  return (first->number > second->number) - (first->number < second->number);
+}
+
+// ----------------------------------------------------------------------------
+// Adds the config files of a directory in the order of their names, sub
+// directories are not searched
+//
+// @return  exit code of the program, 0 on success
+//
+static int add_directory(Pack* pack, const char* directory)
+{
+  DIR* stream = opendir(directory);
+  if (stream == NULL)
+  {
+    printf(ERROR_DIRECTORY, directory);
+    return 2;
+  }
+  size_t first = pack->count;
+  size_t extension = strlen(CONFIG_EXTENSION);
+  struct dirent* entry;
+  while ((entry = readdir(stream)) != NULL)
+  {
+    size_t length = strlen(entry->d_name);
+    if (length <= extension || strcmp(entry->d_name + length - extension, CONFIG_EXTENSION) != 0)
+    {
+      continue;
+    }
+    size_t size = strlen(directory) + length + 2;
+    char* path = (char*) malloc(size);
+    if (path != NULL)
+    {
+      snprintf(path, size, "%s/%s", directory, entry->d_name);
+    }
+    if (path == NULL || !add_levels(pack, path))
+    {
+      closedir(stream);
+      printf("%s", ERROR_OUT_OF_MEMORY);
+      return 4;
+    }
+  }
+  closedir(stream);
+  qsort(pack->results + first, pack->count - first, sizeof(Result), compare_paths);
+  return 0;
+}
+
+// ----------------------------------------------------------------------------
+// Loads a config file or a level of a pack and looks for the fewest
+// rotations that solve it
+//
+static void validate(Result* result)
+{
+  double begin = now_ms();
+  LevelPack levels;
+  Level level;
+  Game game;
+  LevelError error = level_pack_open(&levels, result->path);
+  if (error == LEVEL_OK)
+  {
+    error = level_pack_get(&levels, (result->number == 0) ? 0 : result->number - 1, &level);
+    if (error != LEVEL_OK)
+    {
+      level_pack_close(&levels);
+    }
+  }
+  if (error != LEVEL_OK)
+  {
+    result->status = (error == LEVEL_ERROR_OPEN) ? STATUS_UNREADABLE
+      : ((error == LEVEL_ERROR_INVALID) ? STATUS_INVALID : STATUS_MEMORY);
+    result->ms = now_ms() - begin;
+    return;
+  }
+  result->width = level.width;
+  result->height = level.height;
+  bool loaded = game_init(&game, &level);
+  level_close(&level);
+  level_pack_close(&levels);
+  if (!loaded)
+  {
+    result->status = STATUS_MEMORY;
+    result->ms = now_ms() - begin;
+    return;
+  }
+
+  // the connections are rebuilt like in the first turn of the game
+  game_end_turn(&game);
+  Solution solution;
+  if (game_is_solved(&game))
+  {
+    result->status = STATUS_CONNECTED;
+  }
+  else
+  {
+    size_t budget = VALIDATOR_BUDGET / grid_size(&game.grid) + 1;
+    SolverResult solved = solver_solve_limited(&game, true, budget, &solution);
+    result->status = STATUS_OK;
+    if (solved == SOLVER_LIMIT && solution.moves == NULL)
+    {
+      // no solution was found yet, one that does not need the fewest
+      // rotations is usually found much faster
+      solved = solver_solve_limited(&game, false, budget, &solution);
+      result->status = STATUS_TIMEOUT;
+    }
+    switch (solved)
+    {
+      case SOLVER_OK:
+        result->moves = solution.count;
+        solution_free(&solution);
+        break;
+      case SOLVER_LIMIT:
+        result->status = STATUS_TIMEOUT;
+        result->moves = (solution.moves == NULL) ? SIZE_MAX : solution.count;
+        solution_free(&solution);
+        break;
+      case SOLVER_UNSOLVABLE:
+        result->status = STATUS_UNSOLVABLE;
+        break;
+      case SOLVER_MEMORY:
+        result->status = STATUS_MEMORY;
+        break;
+    }
+  }
+  game_free(&game);
+  result->ms = now_ms() - begin;
+}
+
+// ----------------------------------------------------------------------------
+// Validates config files until none is left, every thread takes the next
+// file that no other thread took yet
+//
+static void* run_thread(void* argument)
+{
+  Pack* pack = (Pack*) argument;
+  for (size_t index = atomic_fetch_add(&pack->next, 1); index < pack->count;
+    index = atomic_fetch_add(&pack->next, 1))
+  {
+    validate(&pack->results[index]);
+  }
+  return NULL;
+}
+
+// ----------------------------------------------------------------------------
+// Prints one line per config file in the order they were given and the
+// number of files of every status
+//
+// @return  exit code of the program, 0 if every file can be solved
+//
+static int print_results(const Pack* pack, double seconds, size_t threads)
+{
+  size_t counts[STATUS_COUNT] = { 0 };
+  char moves[24];
+  char number[16];
+  printf("%s", VALIDATOR_HEADER);
+  for (size_t i = 0; i < pack->count; i++)
+  {
+    const Result* result = &pack->results[i];
+    counts[result->status]++;
+    if (result->status == STATUS_OK || result->status == STATUS_CONNECTED
+      || (result->status == STATUS_TIMEOUT && result->moves != SIZE_MAX))
+    {
+      snprintf(moves, sizeof(moves), "%zu", result->moves);
+    }
+    else
+    {
+      snprintf(moves, sizeof(moves), "-");
+    }
+    number[0] = '\0';
+    if (result->number > 0)
+    {
+      snprintf(number, sizeof(number), VALIDATOR_LEVEL, result->number);
+    }
+    printf(VALIDATOR_RESULT, result->path, number, STATUS_NAMES[result->status], result->width, result->height, moves,
+      result->ms);
+  }
+  printf(VALIDATOR_SUMMARY, pack->count, seconds, threads, counts[STATUS_OK], counts[STATUS_CONNECTED],
+    counts[STATUS_TIMEOUT], counts[STATUS_UNSOLVABLE], counts[STATUS_INVALID], counts[STATUS_UNREADABLE], counts[STATUS_MEMORY]);
+  if (counts[STATUS_MEMORY] > 0)
+  {
+    return 4;
+  }
+  return (counts[STATUS_OK] == pack->count) ? 0 : 3;
+}
+
+int main(int argc, char const **argv)
+{
+  if (argc < 2)
+  {
+    printf("%s", USAGE_VALIDATOR);
+    return 1;
+  }
+
+  Pack pack;
+  memset(&pack, 0, sizeof(pack));
+  int result = 0;
+  for (int i = 1; i < argc && result == 0; i++)
+  {
+    struct stat info;
+    if (stat(argv[i], &info) == 0 && S_ISDIR(info.st_mode))
+    {
+      result = add_directory(&pack, argv[i]);
+    }
+    else
+    {
+      // a file that can not be opened shows up as unreadable
+      char* path = strdup(argv[i]);
+      if (path == NULL || !add_levels(&pack, path))
+      {
+        printf("%s", ERROR_OUT_OF_MEMORY);
+        result = 4;
+      }
+    }
+  }
+
+  if (result == 0)
+  {
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t threads = (online > 0) ? (size_t) online : 1;
+    threads = (threads > pack.count) ? pack.count : threads;
+    threads = (threads == 0) ? 1 : threads;
+    pthread_t* workers = (pthread_t*) malloc(threads * sizeof(pthread_t));
+    size_t started = 0;
+    double begin = now_ms();
+    atomic_init(&pack.next, 0);
+    for (; workers != NULL && started + 1 < threads; started++)
+    {
+      if (pthread_create(&workers[started], NULL, run_thread, &pack) != 0)
+      {
+        break;
+      }
+    }
+    // the main thread helps and also covers the case that no thread started
+    run_thread(&pack);
+    for (size_t i = 0; i < started; i++)
+    {
+      pthread_join(workers[i], NULL);
+    }
+    free(workers);
+    result = print_results(&pack, (now_ms() - begin) / 1e3, started + 1);
+  }
+
+  for (size_t i = 0; i < pack.count; i++)
+  {
+    if (pack.results[i].number <= 1)
+    {
+      free(pack.results[i].path);
+    }
+  }
+  free(pack.results);
+  return result;
+}